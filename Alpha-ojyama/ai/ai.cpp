@@ -0,0 +1,23 @@
+#include "ai.h"
+
+namespace ai
+{
+
+// Returns the best candidate of a beam search, that is the one with the highest accumulated chain score
+// The candidate's plan is given if the search followed a form template, see beam::Configs::plan
+Result get_result(beam::Result& result)
+{
+    if (result.candidates.empty()) {
+        return RESULT_DEFAULT;
+    }
+
+    auto best = std::max_element(result.candidates.begin(), result.candidates.end());
+
+    return Result {
+        .placement = best->placement,
+        .plan = best->plan,
+        .eval = best->eval
+    };
+};
+
+};
\ No newline at end of file
@@ -24,4 +24,6 @@ constexpr Result RESULT_DEFAULT = Result {
     .eval = INT32_MIN
 };
 
+Result get_result(beam::Result& result);
+
 };
\ No newline at end of file
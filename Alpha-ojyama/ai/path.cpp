@@ -117,6 +117,54 @@ void Position::denormalize()
     }
 };
 
+// Adds an input
+// Returns false if the sequence is full
+bool Sequence::push(Input input)
+{
+    if (this->size >= CAPACITY) {
+        return false;
+    }
+
+    this->data |= u64(input) << (this->size * 4);
+    this->size += 1;
+
+    return true;
+};
+
+Input Sequence::get(u8 index)
+{
+    assert(index < this->size);
+    return Input((this->data >> (index * 4)) & 0xF);
+};
+
+Input Sequence::back()
+{
+    return this->get(this->size - 1);
+};
+
+u8 Sequence::get_size()
+{
+    return this->size;
+};
+
+bool Sequence::empty()
+{
+    return this->size == 0;
+};
+
+// Unpacks the sequence
+Queue Sequence::get_queue()
+{
+    Queue result;
+    result.reserve(this->size);
+
+    for (u8 i = 0; i < this->size; ++i) {
+        result.push_back(this->get(i));
+    }
+
+    return result;
+};
+
 PositionMap::PositionMap()
 {
     this->clear();
@@ -127,20 +175,20 @@ void PositionMap::clear()
     for (int x = 0; x < 6; ++x) {
         for (int y = 0; y < 5; ++y) {
             for (int r = 0; r < 4; ++r) {
-                this->data[x][y][r].clear();
+                this->data[x][y][r] = Sequence();
             }
         }
     }
 };
 
-Queue PositionMap::get(i8 x, i8 y, direction::Type direction)
+Sequence PositionMap::get(i8 x, i8 y, direction::Type direction)
 {
     assert(x >= 0 && x <= 5);
     assert(y > 10 && y < 16);
     return this->data[x][y - 11][static_cast<u8>(direction)];
 };
 
-void PositionMap::set(i8 x, i8 y, direction::Type direction, Queue value)
+void PositionMap::set(i8 x, i8 y, direction::Type direction, Sequence value)
 {
     assert(x >= 0 && x <= 5);
     assert(y > 10 && y < 16);
@@ -156,19 +204,19 @@ void PlacementMap::clear()
 {
     for (int x = 0; x < 6; ++x) {
         for (int r = 0; r < 4; ++r) {
-            this->data[x][r].clear();
+            this->data[x][r] = Sequence();
         }
     }
 };
 
-Queue PlacementMap::get(u8 x, direction::Type direction)
+Sequence PlacementMap::get(u8 x, direction::Type direction)
 {
     assert(x >= 0 && x <= 5);
     assert(int(direction) >= 0 && int(direction) <= 4);
     return this->data[x][static_cast<uint8_t>(direction)];
 };
 
-void PlacementMap::set(u8 x, direction::Type direction, Queue value)
+void PlacementMap::set(u8 x, direction::Type direction, Sequence value)
 {
     assert(x >= 0 && x <= 5);
     assert(int(direction) >= 0 && int(direction) <= 4);
@@ -185,150 +233,192 @@ Queue Finder::find(Field& field, move::Placement placement, cell::Pair pair)
 
     auto locks = Finder::generate_placements(field, placement, pair);
 
-    Position position = { .x = int8_t(placement.x), .y = 0, .r = placement.r };
-    
-    Queue result = {};
-
-    if (pair.first == pair.second) {
-        auto position_normalize = position;
-        auto position_denormalize = position;
+    Queue result = Finder::get_path(locks, placement, pair.first == pair.second).get_queue();
 
-        position_normalize.normalize();
-        position_denormalize.denormalize();
+    result.push_back(Input::DROP);
 
-        auto queue_normalize = locks.get(position_normalize.x, position_normalize.r);
-        auto queue_denormalize = locks.get(position_denormalize.x, position_denormalize.r);
+    return Finder::get_queue_convert_m180(result);
+};
 
-        result = std::max(
-            queue_normalize,
-            queue_denormalize,
-            [&] (const Queue& a, const Queue& b) {
-                bool a_valid = !a.empty();
-                bool b_valid = !b.empty();
+// Gets the paths to every placement
+// Uses the precomputed table if it's loaded
+PlacementMap Finder::generate_placements(Field& field, move::Placement placement, cell::Pair pair)
+{
+    auto& table = path::get_table();
 
-                if (a_valid != b_valid) {
-                    return a_valid < b_valid;
-                }
+    if (!table.is_empty()) {
+        u8 heights[6];
+        field.get_heights(heights);
 
-                return a.size() > b.size();
-            }
-        );
-    }
-    else {
-        result = locks.get(position.x, position.r);
+        return table.get(heights);
     }
 
-    result.push_back(Input::DROP);
-
-    return Finder::get_queue_convert_m180(result);
+    return Finder::search_placements(field);
 };
 
-PlacementMap Finder::generate_placements(Field& field, move::Placement placement, cell::Pair pair)
+// Searches for the paths to every placement
+PlacementMap Finder::search_placements(Field& field)
 {
-    bool equal_pair = pair.first == pair.second;
-
     u8 height[6];
     field.get_heights(height);
 
-    std::vector<Finder::Node> queue;
+    avec<Finder::Node, Finder::STACK_MAX> queue;
     PositionMap queue_map = PositionMap();
     PlacementMap locks_map = PlacementMap();
 
-    queue.push_back({{ 2, 11, direction::Type::UP }, Queue()});
-    queue_map.set(2, 11, direction::Type::UP, Queue());
+    queue.add({{ 2, 11, direction::Type::UP }, Sequence()});
+    queue_map.set(2, 11, direction::Type::UP, Sequence());
 
-    while (!queue.empty())
+    while (queue.get_size() > 0)
     {
-        Finder::Node node = queue.back();
-        queue.pop_back();
+        Finder::Node node = queue[queue.get_size() - 1];
+        queue.pop();
 
-        if (queue_map.get(node.position.x, node.position.y, node.position.r).size() != node.path.size()) {
+        if (queue_map.get(node.position.x, node.position.y, node.position.r).get_size() != node.path.get_size()) {
             continue;
         }
 
-        Finder::lock(node, locks_map, equal_pair);
+        Finder::lock(node, locks_map, false);
         Finder::expand(field, height, node, queue, queue_map);
     }
 
     return locks_map;
 };
 
-void Finder::expand(Field& field, u8 height[6], Finder::Node& node, std::vector<Finder::Node>& queue, PositionMap& queue_map)
+void Finder::expand(Field& field, u8 height[6], Finder::Node& node, avec<Finder::Node, Finder::STACK_MAX>& queue, PositionMap& queue_map)
 {
     Finder::Node right = node;
     if (right.position.move_right(field, height)) {
-        if (right.path.size() > 0 && right.path[right.path.size() - 1] == Input::RIGHT) {
-            right.path.push_back(Input::NONE);
-        }
-        right.path.push_back(Input::RIGHT);
-        if (queue_map.get(right.position.x, right.position.y, right.position.r).size() == 0 ||
-            queue_map.get(right.position.x, right.position.y, right.position.r).size() >= right.path.size()) {
-            queue.push_back(right);
-            queue_map.set(right.position.x, right.position.y, right.position.r, right.path);
-        }
+        Finder::push(right, Input::RIGHT, queue, queue_map);
     }
 
     Finder::Node left = node;
-    if (left.position.move_left(field, height)) { 
-        if (left.path.size() > 0 && left.path[left.path.size() - 1] == Input::LEFT) { 
-            left.path.push_back(Input::NONE); 
-        } 
-        left.path.push_back(Input::LEFT);
-        if (queue_map.get(left.position.x, left.position.y, left.position.r).size() == 0 || 
-            queue_map.get(left.position.x, left.position.y, left.position.r).size() >= left.path.size()) { 
-            queue.push_back(left);
-            queue_map.set(left.position.x, left.position.y, left.position.r, left.path);
-        }
+    if (left.position.move_left(field, height)) {
+        Finder::push(left, Input::LEFT, queue, queue_map);
     }
 
     Finder::Node cw = node;
     if (cw.position.move_cw(field, height)) {
-        if (cw.path.size() > 0 && cw.path[cw.path.size() - 1] == Input::CW) {
-            cw.path.push_back(Input::NONE); 
-        }
-        cw.path.push_back(Input::CW);
-        if (queue_map.get(cw.position.x, cw.position.y, cw.position.r).size() == 0 || 
-            queue_map.get(cw.position.x, cw.position.y, cw.position.r).size() >= cw.path.size()) {
-            queue.push_back(cw);
-            queue_map.set(cw.position.x, cw.position.y, cw.position.r, cw.path);
-        }
+        Finder::push(cw, Input::CW, queue, queue_map);
     }
 
     Finder::Node ccw = node;
     if (ccw.position.move_ccw(field, height)) {
-        if (ccw.path.size() > 0 && ccw.path[ccw.path.size() - 1] == Input::CCW) { 
-            ccw.path.push_back(Input::NONE); 
-        } 
-        ccw.path.push_back(Input::CCW);
-        if (queue_map.get(ccw.position.x, ccw.position.y, ccw.position.r).size() == 0 || 
-            queue_map.get(ccw.position.x, ccw.position.y, ccw.position.r).size() >= ccw.path.size()) {
-            queue.push_back(ccw);
-            queue_map.set(ccw.position.x, ccw.position.y, ccw.position.r, ccw.path);
-        }
+        Finder::push(ccw, Input::CCW, queue, queue_map);
     }
 
     Finder::Node m180 = node;
     if (m180.position.move_180(field, height)) {
-        if (m180.path.size() > 0 && m180.path[m180.path.size() - 1] == Input::M180) { 
-            m180.path.push_back(Input::NONE); 
+        Finder::push(m180, Input::M180, queue, queue_map);
+    }
+};
+
+// Adds the input to a moved node's path and pushes the node if its path is the shortest one to its position
+// The same input can't be pressed twice in a row, so we wait 1 frame between them
+// A path longer than Sequence::CAPACITY is dropped, it can't be the shortest one, see Finder
+void Finder::push(Finder::Node& node, Input input, avec<Finder::Node, Finder::STACK_MAX>& queue, PositionMap& queue_map)
+{
+    if (!node.path.empty() && node.path.back() == input) {
+        if (!node.path.push(Input::NONE)) {
+            return;
         }
-        m180.path.push_back(Input::M180);
-        if (queue_map.get(m180.position.x, m180.position.y, m180.position.r).size() == 0 || 
-            queue_map.get(m180.position.x, m180.position.y, m180.position.r).size() >= m180.path.size()) {
-            queue.push_back(m180);
-            queue_map.set(m180.position.x, m180.position.y, m180.position.r, m180.path);
+    }
+
+    if (!node.path.push(input)) {
+        return;
+    }
+
+    auto best = queue_map.get(node.position.x, node.position.y, node.position.r);
+
+    if (best.empty() || best.get_size() >= node.path.get_size()) {
+        if (queue.get_size() >= Finder::STACK_MAX) {
+            Finder::overflow += 1;
+            return;
         }
+
+        queue.add(node);
+        queue_map.set(node.position.x, node.position.y, node.position.r, node.path);
     }
 };
 
 void Finder::lock(Finder::Node& node, PlacementMap& locks_map, bool equal_pair)
 {
-    if (locks_map.get(node.position.x, node.position.r).size() == 0 ||
-        locks_map.get(node.position.x, node.position.r).size() > node.path.size()) {
+    if (locks_map.get(node.position.x, node.position.r).empty() ||
+        locks_map.get(node.position.x, node.position.r).get_size() > node.path.get_size()) {
         locks_map.set(node.position.x, node.position.r, node.path);
     }
 };
 
+// Picks the path to a placement
+// Same-color pairs can also reach the placement by its flipped position, so we pick the shortest valid one
+Sequence Finder::get_path(PlacementMap& locks, move::Placement placement, bool equal_pair)
+{
+    Position position = { .x = int8_t(placement.x), .y = 0, .r = placement.r };
+
+    if (!equal_pair) {
+        return locks.get(position.x, position.r);
+    }
+
+    auto position_normalize = position;
+    auto position_denormalize = position;
+
+    position_normalize.normalize();
+    position_denormalize.denormalize();
+
+    auto queue_normalize = locks.get(position_normalize.x, position_normalize.r);
+    auto queue_denormalize = locks.get(position_denormalize.x, position_denormalize.r);
+
+    auto is_worse = [&] (Sequence& a, Sequence& b) {
+        bool a_valid = !a.empty();
+        bool b_valid = !b.empty();
+
+        if (a_valid != b_valid) {
+            return a_valid < b_valid;
+        }
+
+        return a.get_size() > b.get_size();
+    };
+
+    if (is_worse(queue_normalize, queue_denormalize)) {
+        return queue_denormalize;
+    }
+
+    return queue_normalize;
+};
+
+// Gets the input frames of every valid placement at once
+// This counts the same inputs as find(), including the drop input and the 180 rotations' extra inputs, so a placement costs at least 1 frame
+// The paths come from a single placement search, so this is as fast as 1 call to find()
+Frames Finder::get_frames(Field& field, bool equal_pair)
+{
+    Frames result = Frames();
+
+    auto locks = Finder::generate_placements(field, move::Placement(), { cell::Type::RED, cell::Type::RED });
+
+    auto placements = move::generate(field, equal_pair);
+
+    for (i32 i = 0; i < placements.get_size(); ++i) {
+        auto& placement = placements[i];
+        u8 count = 1;
+
+        if (placement.x != 2 || placement.r != direction::Type::UP) {
+            auto path = Finder::get_path(locks, placement, equal_pair);
+
+            count += path.get_size();
+
+            for (u8 k = 0; k < path.get_size(); ++k) {
+                if (path.get(k) == Input::M180) {
+                    count += 10;
+                }
+            }
+        }
+
+        result.data[placement.x][static_cast<u8>(placement.r)] = count;
+    }
+
+    return result;
+};
+
 bool Finder::above_stack_move(Field& field, move::Placement placement, u8 stack)
 {
     u8 heights[6];
@@ -452,7 +542,7 @@ Queue Finder::cancel_vertical(u8 height[6], move::Placement placement, cell::Pai
 
     // Left
     if (placement.x < 2 && height[placement.x] > height[placement.x + 1]) {
-        auto queue = locks.get(placement.x + 1, placement.r);
+        auto queue = locks.get(placement.x + 1, placement.r).get_queue();
 
         if (placement.x + 1 == 2 && placement.r == direction::Type::UP) {
             queue = {};
@@ -467,7 +557,7 @@ Queue Finder::cancel_vertical(u8 height[6], move::Placement placement, cell::Pai
 
     // Right
     if (placement.x > 2 && height[placement.x] > height[placement.x - 1]) {
-        auto queue = locks.get(placement.x - 1, placement.r);
+        auto queue = locks.get(placement.x - 1, placement.r).get_queue();
 
         if (placement.x + 1 == 2 && placement.r == direction::Type::UP) {
             queue = {};
@@ -976,4 +1066,134 @@ Queue Finder::cancel_step(u8 height[6], move::Placement placement, cell::Pair pa
     return {};
 };
 
+// Generates the table
+void Table::build()
+{
+    this->data.assign(SIZE, PlacementMap());
+
+    for (size_t i = 0; i < SIZE; ++i) {
+        // Creates a field with the signature's heights
+        auto field = Field();
+
+        for (i8 x = 0; x < 6; ++x) {
+            i8 height = 10 + i8((i >> (x * 2)) & 0b11);
+
+            for (i8 y = 0; y < height; ++y) {
+                field.set_cell(x, y, cell::Type::GARBAGE);
+            }
+        }
+
+        this->data[i] = Finder::search_placements(field);
+    }
+};
+
+// Saves the table to a binary file
+bool Table::save(const std::string& path)
+{
+    std::ofstream file(path, std::ios::binary);
+
+    if (!file.good()) {
+        return false;
+    }
+
+    u32 header[2] = { MAGIC, u32(this->data.size()) };
+    file.write((const char*)header, sizeof(header));
+
+    for (auto& map : this->data) {
+        for (i32 x = 0; x < 6; ++x) {
+            for (i32 r = 0; r < 4; ++r) {
+                file.write((const char*)&map.data[x][r].data, sizeof(u64));
+                file.write((const char*)&map.data[x][r].size, sizeof(u8));
+            }
+        }
+    }
+
+    return file.good();
+};
+
+// Loads the table from a binary file
+// Returns false and keeps the table empty if the file is missing or invalid
+bool Table::load(const std::string& path)
+{
+    this->data.clear();
+
+    std::ifstream file(path, std::ios::binary);
+
+    if (!file.good()) {
+        return false;
+    }
+
+    u32 header[2] = { 0, 0 };
+    file.read((char*)header, sizeof(header));
+
+    if (!file.good() || header[0] != MAGIC || header[1] != SIZE) {
+        return false;
+    }
+
+    std::vector<PlacementMap> result(SIZE);
+
+    for (auto& map : result) {
+        for (i32 x = 0; x < 6; ++x) {
+            for (i32 r = 0; r < 4; ++r) {
+                file.read((char*)&map.data[x][r].data, sizeof(u64));
+                file.read((char*)&map.data[x][r].size, sizeof(u8));
+
+                if (map.data[x][r].size > Sequence::CAPACITY) {
+                    return false;
+                }
+            }
+        }
+    }
+
+    if (!file.good()) {
+        return false;
+    }
+
+    this->data = std::move(result);
+
+    return true;
+};
+
+bool Table::is_empty()
+{
+    return this->data.empty();
+};
+
+PlacementMap& Table::get(u8 heights[6])
+{
+    return this->data[Table::get_index(heights)];
+};
+
+// Gets the signature of a field's heights
+size_t Table::get_index(u8 heights[6])
+{
+    size_t index = 0;
+
+    for (i32 x = 0; x < 6; ++x) {
+        size_t h = std::clamp(i32(heights[x]), 10, 13) - 10;
+        index |= h << (x * 2);
+    }
+
+    return index;
+};
+
+// The table used by the path finder
+// It's loaded from TABLE_PATH the first time it's used, and built in memory if the file is missing or invalid, which only takes a few ms
+// Call it once at startup so that the first search doesn't pay for it
+Table& get_table()
+{
+    static Table table = [] () {
+        Table result;
+
+        if (!result.load(TABLE_PATH)) {
+            fprintf(stderr, "path: can't load %s, building the path table\n", TABLE_PATH);
+            result.build();
+        }
+
+        return result;
+    }();
+
+    return table;
+};
+
 };
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../core/core.h"
+#include <fstream>
 
 namespace path
 {
@@ -24,6 +25,23 @@ enum class Input
 
 typedef std::vector<Input> Queue;
 
+// An input sequence packed 4 bits per input, so that it can be copied and stored without allocating
+class Sequence
+{
+public:
+    static constexpr u8 CAPACITY = 16;
+public:
+    u64 data = 0;
+    u8 size = 0;
+public:
+    bool push(Input input);
+    Input get(u8 index);
+    Input back();
+    u8 get_size();
+    bool empty();
+    Queue get_queue();
+};
+
 class Position
 {
 public:
@@ -46,43 +64,64 @@ public:
 class PositionMap
 {
 public:
-    Queue data[6][5][4];
+    Sequence data[6][5][4];
 public:
     PositionMap();
 public:
     void clear();
 public:
-    Queue get(i8 x, i8 y, direction::Type direction);
-    void set(i8 x, i8 y, direction::Type direction, Queue value);
+    Sequence get(i8 x, i8 y, direction::Type direction);
+    void set(i8 x, i8 y, direction::Type direction, Sequence value);
 };
 
 class PlacementMap
 {
 public:
-    Queue data[6][4];
+    Sequence data[6][4];
 public:
     PlacementMap();
 public:
     void clear();
 public:
-    Queue get(u8 x, direction::Type direction);
-    void set(u8 x, direction::Type direction, Queue value);
+    Sequence get(u8 x, direction::Type direction);
+    void set(u8 x, direction::Type direction, Sequence value);
 };
 
+// The input frames of every placement of a field, see Finder::get_frames()
+struct Frames
+{
+    u8 data[6][4] = {};
+
+    u8 get(move::Placement placement) { return this->data[placement.x][static_cast<u8>(placement.r)]; };
+};
+
+// The path finder doesn't allocate, except for the returned input queues
+// The search's stack and paths are bounded, the bounds were checked on every field signature of the Table, which covers every field:
+// - the stack never holds more than 15 nodes, so STACK_MAX has a lot of headroom
+// - every placement's shortest path has at most 15 inputs, so the paths that don't fit in a Sequence are never the shortest ones
+// Nodes that don't fit in the stack are dropped and counted in "overflow", which must stay at 0, see test/main.cpp
 class Finder
 {
 public:
     struct Node
     {
         Position position;
-        Queue path;
+        Sequence path;
     };
+public:
+    static constexpr i32 STACK_MAX = 256;
+    static inline std::atomic<u64> overflow = 0;
 public:
     static Queue find(Field& field, move::Placement placement, cell::Pair pair);
     static PlacementMap generate_placements(Field& field, move::Placement placement, cell::Pair pair);
-    static void expand(Field& field, u8 height[6], Node& node, std::vector<Node>& queue, PositionMap& queue_map);
+    static PlacementMap search_placements(Field& field);
+    static void expand(Field& field, u8 height[6], Node& node, avec<Node, STACK_MAX>& queue, PositionMap& queue_map);
+    static void push(Node& node, Input input, avec<Node, STACK_MAX>& queue, PositionMap& queue_map);
     static void lock(Node& node, PlacementMap& locks_map, bool equal_pair);
     static Queue get_queue_convert_m180(Queue& queue);
+public:
+    static Sequence get_path(PlacementMap& locks, move::Placement placement, bool equal_pair);
+    static Frames get_frames(Field& field, bool equal_pair);
 public:
     static bool above_stack_move(Field& field, move::Placement placement, u8 stack = 8);
 public:
@@ -93,6 +132,34 @@ public:
     static Queue cancel_step(u8 height[6], move::Placement placement, cell::Pair pair, PlacementMap& locks);
 };
 
+// The precomputed placement paths of every field
+// The path finder only checks the cells from row 11 to row 14, so its results only depend on each column's height clamped to {<= 10, 11, 12, >= 13}
+// The 14th row doesn't matter either, since a pair can only reach it above a column of height 13, which blocks the pair first
+// That's 4^6 signatures of 24 paths each, generated offline with build() and save(), then loaded at startup, see get_table()
+// The cancel paths compare the whole columns' heights below row 11, so they can't be keyed by these signatures
+// Only their placement paths come from the table, the cancel branching itself is a few height comparisons and stays live
+class Table
+{
+public:
+    static constexpr size_t SIZE = 1 << 12;
+    static constexpr u32 MAGIC = 0x4C425450;
+public:
+    std::vector<PlacementMap> data;
+public:
+    void build();
+    bool save(const std::string& path);
+    bool load(const std::string& path);
+public:
+    bool is_empty();
+    PlacementMap& get(u8 heights[6]);
+public:
+    static size_t get_index(u8 heights[6]);
+};
+
+constexpr const char* TABLE_PATH = "path.bin";
+
+Table& get_table();
+
 static void print(Queue queue)
 {
     for (auto mv : queue) {
@@ -0,0 +1,217 @@
+#include "attack.h"
+
+namespace beam
+{
+
+namespace attack
+{
+
+// Searches for attacks with beam search
+// Returns the same candidates as dfs::attack::search():
+// - "attacks" and "attacks_ac" are the attacks triggered within the given queue
+// - "attacks_detect" are the attacks triggered within the random queues, or the chains that could be triggered at the end of the queue
+// The layers within the given queue are searched once, then the last layer is continued with every random queue on the caller's pool
+dfs::attack::Result search(
+    Field field,
+    cell::Queue queue,
+    eval::Weight w,
+    Pool& pool,
+    Configs configs
+)
+{
+    auto result = dfs::attack::Result();
+
+    // Checks queue
+    if (queue.size() < 2) {
+        return result;
+    }
+
+    // Creates root
+    auto root = node::Data {
+        .field = field,
+        .score = { 0, 0 },
+        .index = -1
+    };
+
+    // Selects the evaluation function specialized for this weight profile
+    auto evaluate = eval::get_function(w);
+
+    // Creates stack
+    std::array<Layer, 2> layers = {
+        Layer(configs.width),
+        Layer(configs.width)
+    };
+
+    // The attacks collected for every candidate
+    std::vector<dfs::attack::Candidate> candidates;
+    std::vector<dfs::attack::Collection> collections;
+
+    // Collects an attack triggered within the given queue
+    // The fields are copied only into the attacks that are kept
+    auto collect = [&] (node::Data& child, const dfs::attack::Data& attack, const Field& parent) {
+        auto& candidate = candidates[child.index];
+        auto& collection = collections[child.index];
+
+        auto fill = [&] (dfs::attack::Data& a) {
+            a.parent = parent;
+            a.result = child.field;
+        };
+
+        collection.attacks.add(attack, fill);
+
+        // Checks all clear
+        if (attack.all_clear) {
+            collection.attacks_ac.add(attack, fill);
+        }
+
+        // Updates max attack
+        if (dfs::attack::cmp_main(candidate.attack_max, attack)) {
+            candidate.attack_max = attack;
+            fill(candidate.attack_max);
+        }
+    };
+
+    // Initializes candidates
+    attack::expand(
+        queue[0],
+        root,
+        w,
+        evaluate,
+        configs,
+        [&] (node::Data& child, const move::Placement& placement, const dfs::attack::Data& attack, const Field& parent) {
+            child.index = i32(candidates.size());
+
+            candidates.push_back(dfs::attack::Candidate {
+                .placement = placement,
+                .attack_max = dfs::attack::Data(),
+                .attacks = std::vector<dfs::attack::Data>(),
+                .attacks_ac = std::vector<dfs::attack::Data>(),
+                .attacks_detect = std::vector<dfs::attack::Data>()
+            });
+
+            collections.push_back(dfs::attack::Collection {
+                .attacks = dfs::attack::Collector(configs.keep),
+                .attacks_ac = dfs::attack::Collector(configs.keep),
+                .attacks_detect = dfs::attack::Collector(configs.keep)
+            });
+
+            if (attack.count > 0) {
+                collect(child, attack, parent);
+            }
+
+            layers[0].data.push_back(child);
+        }
+    );
+
+    // If there aren't any candidates, stops searching
+    if (candidates.empty()) {
+        return result;
+    }
+
+    // Searches the given queue
+    for (size_t i = 1; i < queue.size(); ++i) {
+        attack::think(
+            queue[i],
+            layers[(i - 1) & 1],
+            layers[i & 1],
+            w,
+            evaluate,
+            configs,
+            collect
+        );
+    }
+
+    auto& last = layers[(queue.size() - 1) & 1];
+
+    if (configs.depth > queue.size()) {
+        // Continues searching with the random queues
+        // Each random queue collects into its own collectors, which are merged in order after its tasks are done
+        std::vector<std::vector<dfs::attack::Collector>> detects(beam::BRANCH);
+
+        Pool::Group group;
+
+        for (size_t b = 0; b < beam::BRANCH; ++b) {
+            pool.submit([&, b] () {
+                auto qrng = beam::get_queue_random(i32(b), configs.depth - queue.size());
+
+                auto& detect = detects[b];
+                detect.resize(candidates.size(), dfs::attack::Collector(configs.keep));
+
+                std::array<Layer, 2> branch = {
+                    Layer(configs.width),
+                    Layer(configs.width)
+                };
+
+                branch[0].data = last.data;
+
+                for (size_t i = 0; i < qrng.size(); ++i) {
+                    attack::think(
+                        qrng[i],
+                        branch[i & 1],
+                        branch[(i + 1) & 1],
+                        w,
+                        evaluate,
+                        configs,
+                        [&] (node::Data& child, const dfs::attack::Data& attack, const Field& parent) {
+                            detect[child.index].add(attack, [&] (dfs::attack::Data& a) {
+                                a.parent = parent;
+                                a.result = child.field;
+                            });
+                        }
+                    );
+                }
+            }, &group);
+        }
+
+        pool.wait(group);
+
+        for (auto& detect : detects) {
+            for (size_t i = 0; i < candidates.size(); ++i) {
+                collections[i].attacks_detect.merge(detect[i]);
+            }
+        }
+    }
+    else {
+        // Searches for the chains that could be triggered at the end of the queue
+        for (auto& node : last.data) {
+            auto n = dfs::attack::Node {
+                .field = node.field,
+                .score = node.sent.score,
+                .frame = node.sent.frame
+            };
+
+            dfs::attack::visit(
+                n,
+                queue,
+                candidates[node.index],
+                collections[node.index],
+                i32(queue.size()),
+                true,
+                configs.frame_delay,
+                configs.path
+            );
+        }
+    }
+
+    // Gets the results
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        auto& candidate = candidates[i];
+
+        candidate.attacks = collections[i].attacks.get();
+        candidate.attacks_ac = collections[i].attacks_ac.get();
+        candidate.attacks_detect = collections[i].attacks_detect.get();
+
+        // Dead end, same as dfs::attack::search() so that the candidates are the same
+        if (candidate.attacks.empty()) {
+            continue;
+        }
+
+        result.candidates.push_back(std::move(candidate));
+    }
+
+    return result;
+};
+
+};
+
+};
\ No newline at end of file
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "beam.h"
+#include "../dfs/attack.h"
+
+namespace beam
+{
+
+namespace attack
+{
+
+// Attack search with beam search
+// Unlike dfs::attack, we keep only the best "width" nodes at each depth, so we can search "depth" pairs ahead
+// The nodes are ranked by the build eval, which estimates their remaining potential, plus the attacks they already sent:
+// - "score" is added for every point of chain score sent
+// - "frame" is added for every frame spent
+// If "depth" is longer than the queue, the search continues with the same random queues as search_multi()
+// Otherwise, we search for the chains that could be triggered at the end of the queue, like dfs::attack with "detect"
+// Like dfs::attack, candidates without any attack in the given queue are dead ends, so both searches return the same candidates
+// "keep" limits the attacks kept by each candidate, see dfs::attack::Collector
+// If "path" is set, the frames spent also count the real input frames of the placements, see path::Finder::get_frames()
+struct Configs
+{
+    size_t width = 100;
+    size_t depth = 8;
+    size_t keep = 0;
+    i32 frame_delay = 0;
+    i32 score = 1;
+    i32 frame = 0;
+    bool path = false;
+};
+
+// Expands node and updates the children's sent attacks and ranks
+// The callback is called with (child, placement, attack, parent field) for every valid child, the attack's count is 0 if the child didn't trigger a chain
+// The attack's "parent" and "result" fields are left empty, the callback fills them only for the attacks it keeps, see dfs::attack::Collector::add()
+template <typename T>
+inline void expand(
+    const cell::Pair& pair,
+    node::Data& node,
+    const eval::Weight& w,
+    eval::Function evaluate,
+    const Configs& configs,
+    T&& callback
+)
+{
+    path::Frames frames;
+
+    if (configs.path) {
+        frames = path::Finder::get_frames(node.field, pair.first == pair.second);
+    }
+
+    beam::expand(pair, node, w, evaluate, configs.path ? &frames : nullptr, [&] (node::Data& child, const move::Placement& placement, const chain::Score& chain) {
+        i32 frame = node.field.get_drop_pair_frame(placement.x, placement.r);
+
+        if (configs.path) {
+            frame += frames.get(placement) - 1;
+        }
+
+        auto attack = dfs::attack::Data();
+
+        if (chain.count > 0) {
+            attack = dfs::attack::Data {
+                .count = chain.count,
+                .score = chain.score,
+                .score_total = node.sent.score + chain.score,
+                .frame = node.sent.frame,
+                .frame_real = node.sent.frame + frame,
+                .all_clear = child.field.is_empty(),
+                .redundancy = INT32_MAX,
+                .link = dfs::eval::get_link(child.field)
+            };
+        }
+
+        // Updates stats
+        i32 frame_total = frame + chain.count * 2 + configs.frame_delay;
+
+        child.sent.score += chain.score;
+        child.sent.frame += frame_total;
+        child.score.action += chain.score * configs.score + frame_total * configs.frame;
+
+        callback(child, placement, attack, node.field);
+    });
+};
+
+// Does 1 iteration of beam search from the parents layer to the children layer
+// The callback is called with (child, attack, parent field) for every child that triggered a chain
+template <typename T>
+inline void think(
+    const cell::Pair& pair,
+    Layer& parents,
+    Layer& children,
+    const eval::Weight& w,
+    eval::Function evaluate,
+    const Configs& configs,
+    T&& callback
+)
+{
+    // Sorts the parents layer
+    parents.sort();
+
+    // Expands each parent to the next layer
+    for (auto& node : parents.data) {
+        attack::expand(pair, node, w, evaluate, configs, [&] (node::Data& child, const move::Placement& placement, const dfs::attack::Data& attack, const Field& parent) {
+            if (attack.count > 0) {
+                callback(child, attack, parent);
+            }
+
+            children.add(child);
+        });
+    }
+
+    // Clears the parents layer
+    parents.clear();
+};
+
+dfs::attack::Result search(
+    Field field,
+    cell::Queue queue,
+    eval::Weight w,
+    Pool& pool,
+    Configs configs = Configs()
+);
+
+};
+
+};
\ No newline at end of file
@@ -3,43 +3,15 @@
 namespace beam
 {
 
-// Expands node
-void expand(
-    const cell::Pair& pair,
-    node::Data& node,
-    const eval::Weight& w,
-    std::function<void(node::Data&, const move::Placement&, const chain::Score&)> callback
-)
-{
-    auto locks = move::generate(node.field, pair.first == pair.second);
-
-    for (auto i = 0; i < locks.get_size(); ++i) {
-        auto child = node;
-        
-        child.field.drop_pair(locks[i].x, locks[i].r, pair);
-
-        auto pop = child.field.pop();
-
-        if (child.field.get_height(2) > 11) {
-            continue;
-        }
-
-        i32 tear = node.field.get_drop_pair_frame(locks[i].x, locks[i].r) - 1;
-        i32 waste = pop.get_size();
-
-        eval::evaluate(child, tear, waste, w);
-
-        callback(child, locks[i], chain::get_score(pop));
-    }
-};
-
 // Does 1 iteration of beam search from the parents layer to the children layer
 void think(
     const cell::Pair& pair,
     std::vector<Candidate>& candidates,
     Layer& parents,
     Layer& children,
-    const eval::Weight& w
+    const eval::Weight& w,
+    eval::Function evaluate,
+    bool path
 )
 {
     // Sorts the parents layer
@@ -47,7 +19,13 @@ void think(
 
     // Expands each parent to the next layer
     for (auto& node : parents.data) {
-        beam::expand(pair, node, w, [&] (node::Data& child, const move::Placement& placement, const chain::Score& chain) {
+        path::Frames frames;
+
+        if (path) {
+            frames = path::Finder::get_frames(node.field, pair.first == pair.second);
+        }
+
+        beam::expand(pair, node, w, evaluate, path ? &frames : nullptr, [&] (node::Data& child, const move::Placement& placement, const chain::Score& chain) {
             candidates[child.index].score = std::max(candidates[child.index].score, size_t(chain.score));
 
             // Prunes children that triggered big chains
@@ -83,22 +61,39 @@ Result search(
         .index = -1
     };
 
+    // Selects the evaluation function specialized for this weight profile
+    auto evaluate = eval::get_function(w, configs.plan);
+
     // Creates stack
     std::array<Layer, 2> layers = {
         Layer(configs.width),
         Layer(configs.width)
     };
 
+    // Gets the real input frames of the first placements
+    path::Frames frames;
+
+    if (configs.path) {
+        frames = path::Finder::get_frames(root.field, queue[0].first == queue[0].second);
+    }
+
     // Initializes candidates
     beam::expand(
         queue[0],
         root,
         w,
+        evaluate,
+        configs.path ? &frames : nullptr,
         [&] (node::Data& child, const move::Placement& placement, const chain::Score& chain) {
             auto candidate = beam::Candidate();
 
             candidate.placement = placement;
             candidate.score = chain.score;
+            candidate.eval = child.score.eval;
+
+            if (child.plan.has_value()) {
+                candidate.plan = child.plan->field;
+            }
 
             child.index = i32(result.candidates.size());
 
@@ -119,9 +114,15 @@ Result search(
             result.candidates,
             layers[i & 1],
             layers[(i + 1) & 1],
-            w
+            w,
+            evaluate,
+            configs.path
         );
 
+        if (configs.progress) {
+            configs.progress(result);
+        }
+
         bool enough = false;
 
         for (auto& c : result.candidates) {
@@ -134,6 +135,11 @@ Result search(
         if (enough) {
             break;
         }
+
+        // Stops if we are cancelled or out of time
+        if (configs.stop != nullptr && configs.stop->is_stopped()) {
+            break;
+        }
     }
 
     return result;
@@ -213,10 +219,12 @@ Result search_multi(
 {
     auto result = Result();
 
+    size_t branch = std::clamp(configs.branch, size_t(1), beam::BRANCH);
+
     // Creates future queues
     std::vector<cell::Queue> queues;
 
-    for (auto i = 0; i < beam::BRANCH; ++i) {
+    for (auto i = 0; i < branch; ++i) {
         auto q = queue;
         auto qrng = beam::get_queue_random(i, configs.depth - queue.size());
 
@@ -225,36 +233,81 @@ Result search_multi(
         queues.push_back(q);
     }
 
+    // Accumulates the biggest chain scores of each candidate
+    // A candidate keeps its plan and evaluation from whichever queue found them, so the selected candidate's plan doesn't depend on which search finished first
+    auto accumulate = [] (Result& result, const Result& b) {
+        if (b.candidates.empty()) {
+            return;
+        }
+
+        // If this is the first finished search
+        if (result.candidates.empty()) {
+            result = b;
+            return;
+        }
+
+        for (auto& c1 : result.candidates) {
+            for (auto& c2 : b.candidates) {
+                if (c1.placement == c2.placement) {
+                    c1.score += c2.score;
+                    c1.eval = std::max(c1.eval, c2.eval);
+
+                    if (!c1.plan.has_value()) {
+                        c1.plan = c2.plan;
+                    }
+
+                    break;
+                }
+            }
+        }
+    };
+
+    // Sorts candidates by their total accumulated scores
+    auto sort = [] (Result& result) {
+        std::sort(
+            result.candidates.begin(),
+            result.candidates.end(),
+            [] (const beam::Candidate& a, const beam::Candidate& b) {
+                return a.score > b.score;
+            }
+        );
+    };
+
     // Searching multiple queues at the same time
     std::vector<std::thread> threads;
     std::mutex mtx;
+
+    // The candidates found so far by each queue, for reporting progress
+    std::vector<Result> partials(branch);
     
-    for (auto i = 0; i < beam::BRANCH; ++i) {
+    for (auto i = 0; i < branch; ++i) {
         threads.emplace_back([&] (i32 id) {
-            // Beam search for 1 queue
-            auto b = beam::search(field, queues[id], w, configs);
+            auto c = configs;
 
-            if (b.candidates.empty()) {
-                return;
-            }
+            if (configs.progress) {
+                c.progress = [&, id] (const Result& b) {
+                    std::lock_guard<std::mutex> lk(mtx);
 
-            std::lock_guard<std::mutex> lk(mtx);
+                    partials[id] = b;
 
-            // If this is the first finished search
-            if (result.candidates.empty()) {
-                result = b;
-                return;
-            }
+                    auto snapshot = Result();
 
-            // Accumulates the biggest chain scores of each candidate
-            for (auto& c1 : result.candidates) {
-                for (auto& c2 : b.candidates) {
-                    if (c1.placement == c2.placement) {
-                        c1.score += c2.score;
-                        break;
+                    for (auto& partial : partials) {
+                        accumulate(snapshot, partial);
                     }
-                }
+
+                    sort(snapshot);
+
+                    configs.progress(snapshot);
+                };
             }
+
+            // Beam search for 1 queue
+            auto b = beam::search(field, queues[id], w, c);
+
+            std::lock_guard<std::mutex> lk(mtx);
+
+            accumulate(result, b);
         }, i);
     }
 
@@ -262,16 +315,7 @@ Result search_multi(
         t.join();
     }
 
-    // Sorts candidates by their total accumulated scores
-    if (!result.candidates.empty()) {
-        std::sort(
-            result.candidates.begin(),
-            result.candidates.end(),
-            [] (const beam::Candidate& a, const beam::Candidate& b) {
-                return a.score > b.score;
-            }
-        );
-    }
+    sort(result);
 
     return result;
 };
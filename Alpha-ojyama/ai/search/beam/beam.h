@@ -2,6 +2,7 @@
 
 #include "layer.h"
 #include "eval.h"
+#include "../../path.h"
 
 namespace beam
 {
@@ -9,17 +10,14 @@ namespace beam
 constexpr size_t BRANCH = 6;
 constexpr size_t PRUNE = 5000;
 
-struct Configs
-{
-    size_t width = 250;
-    size_t depth = 16;
-    size_t trigger = 100000;
-};
-
+// "plan" is the completed template followed by the candidate's node, if any
+// "eval" is the evaluation of the candidate's node
 struct Candidate
 {
     move::Placement placement = move::Placement();
     size_t score = 0;
+    std::optional<Field> plan = std::nullopt;
+    i32 eval = INT32_MIN;
 };
 
 struct Result
@@ -27,19 +25,75 @@ struct Result
     std::vector<Candidate> candidates;
 };
 
-void expand(
+typedef std::function<void(const Result&)> Progress;
+
+// If "plan" is set, nodes matching a form template follow the completed template instead of running the quiescence search
+// This requires a non-zero form weight
+// If "stop" is set, the search returns the candidates' chains found so far once it's stopped
+// If "path" is set, the tear term also counts the real input frames of the placements, see path::Finder::get_frames()
+// If "progress" is set, it's called with the candidates found so far after each layer, search_multi() calls it with the accumulated candidates of all its queues
+// "branch" is the number of random queues searched by search_multi(), at most BRANCH
+struct Configs
+{
+    size_t width = 250;
+    size_t depth = 16;
+    size_t trigger = 100000;
+    bool plan = false;
+    bool path = false;
+    Stop* stop = nullptr;
+    size_t branch = BRANCH;
+    Progress progress = nullptr;
+};
+
+// Expands node
+// The callback is called with (child, placement, chain) for every valid child
+// If "frames" is set, the placements' input frames are added to the tear term
+template <typename T>
+inline void expand(
     const cell::Pair& pair,
     node::Data& node,
     const eval::Weight& w,
-    std::function<void(node::Data&, const move::Placement&, const chain::Score&)> callback
-);
+    eval::Function evaluate,
+    path::Frames* frames,
+    T&& callback
+)
+{
+    auto locks = move::generate(node.field, pair.first == pair.second);
+
+    for (auto i = 0; i < locks.get_size(); ++i) {
+        auto child = node;
+        
+        child.field.drop_pair(locks[i].x, locks[i].r, pair);
+
+        auto pop = child.field.pop();
+
+        if (child.field.get_height(2) > 11) {
+            continue;
+        }
+
+        i32 tear = node.field.get_drop_pair_frame(locks[i].x, locks[i].r) - 1;
+
+        if (frames != nullptr) {
+            tear += frames->get(locks[i]) - 1;
+        }
+
+        i32 waste = pop.get_size();
+
+        // If nothing popped, the child can reuse the parent's quiescence results
+        evaluate(child, pop.get_size() == 0 ? &node : nullptr, tear, waste, w);
+
+        callback(child, locks[i], chain::get_score(pop));
+    }
+};
 
 void think(
     const cell::Pair& pair,
     std::vector<Candidate>& candidates,
     Layer& parents,
     Layer& children,
-    const eval::Weight& w
+    const eval::Weight& w,
+    eval::Function evaluate,
+    bool path
 );
 
 Result search(
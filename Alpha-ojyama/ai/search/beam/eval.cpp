@@ -6,7 +6,137 @@ namespace beam
 namespace eval
 {
 
-void evaluate(node::Data& node, i32 tear, i32 waste, const Weight& w)
+// Returns the best quiescence score of a node
+// The node's quiescence results are updated first, reusing the parent's results if possible
+template <u32 F>
+i32 get_quiet(node::Data& node, const node::Data* parent, u8 heights[6], const Weight& w)
+{
+    i32 q = INT32_MIN;
+
+    eval::search_quiet<(F & term::LINK) != 0>(node, parent);
+
+    for (i8 x = 0; x < 6; ++x) {
+        for (u8 p = 0; p < cell::COUNT - 1; ++p) {
+            auto& quiet = node.quiet.entry[x][p];
+
+            if (quiet.count == 0) {
+                continue;
+            }
+
+            i32 q_score = 0;
+
+            // Potential chain
+            q_score += quiet.count * w.chain;
+
+            // Trigger height
+            q_score += heights[x] * w.y;
+
+            // Key puyos needed
+            q_score += quiet.key * w.key;
+
+            // Space for stretching chain
+            if constexpr (F & term::CHI) {
+                i32 chi = eval::get_chi(heights, x);
+                q_score += chi * w.chi;
+            }
+
+            // Remaining connection
+            if constexpr (F & term::LINK) {
+                q_score += quiet.link_2 * w.link_2;
+                q_score += quiet.link_3 * w.link_3;
+            }
+
+            // Updates the best q score and plan
+            q = std::max(q, q_score);
+        }
+    }
+
+    return q;
+};
+
+// Checks if every puyo of the field agrees with the plan
+bool is_on_plan(const Field& field, const Field& plan)
+{
+    __m128i plan_mask = _mm_setzero_si128();
+
+    for (u8 c = 0; c < cell::COUNT; ++c) {
+        plan_mask = _mm_or_si128(plan_mask, plan.data[c].data);
+    }
+
+    for (u8 c = 0; c < cell::COUNT; ++c) {
+        __m128i wrong = _mm_andnot_si128(plan.data[c].data, field.data[c].data) & plan_mask;
+
+        if (!_mm_testz_si128(wrong, wrong)) {
+            return false;
+        }
+    }
+
+    return true;
+};
+
+// Returns the amount of puyos missing to complete the plan
+i32 get_plan_distance(Field& field, Field& plan)
+{
+    FieldBit missing;
+    missing.data = _mm_andnot_si128(field.get_mask().data, plan.get_mask().data);
+
+    return missing.get_count();
+};
+
+// Finds the node's plan, see Configs::plan
+// A node keeps its parent's plan as long as its puyos agree with the plan
+// Otherwise, we complete the field following the best matching template and cache the completed field's quiescence score
+template <u32 F>
+void search_plan(node::Data& node, const node::Data* parent, const Weight& w)
+{
+    if (parent != nullptr && parent->plan.has_value() && eval::is_on_plan(node.field, parent->plan->field)) {
+        node.plan = parent->plan;
+        return;
+    }
+
+    node.plan = std::nullopt;
+
+    // Finds the best matching template
+    i32 form_best = 0;
+    i32 form_index = -1;
+
+    for (i32 i = 0; i < form::COUNT; ++i) {
+        if (node.form.score[i] > form_best) {
+            form_best = node.form.score[i];
+            form_index = i;
+        }
+    }
+
+    if (form_index < 0) {
+        return;
+    }
+
+    // Completes the field and evaluates it
+    auto plan = node::Plan {
+        .field = form::get_plan(node.field, form::LIST[form_index])
+    };
+
+    auto plan_node = node::Data {
+        .field = plan.field
+    };
+
+    u8 plan_heights[6];
+    plan.field.get_heights(plan_heights);
+
+    plan.q = eval::get_quiet<F>(plan_node, nullptr, plan_heights, w);
+
+    if (plan.q > INT32_MIN) {
+        node.plan = plan;
+    }
+};
+
+// Evaluates a node
+// This version is specialized at compile time for a set of enabled terms
+// Every term whose bit isn't set in F has a weight of 0, so we skip computing its feature entirely
+// If the node was created from its parent without popping, we pass the parent to reuse its quiescence results
+// With the plan term, nodes following a template are scored by their distance to the completed template instead of the quiescence search
+template <u32 F>
+void evaluate(node::Data& node, const node::Data* parent, i32 tear, i32 waste, const Weight& w)
 {
     node.score.eval = 0;
 
@@ -14,14 +144,10 @@ void evaluate(node::Data& node, i32 tear, i32 waste, const Weight& w)
     node.field.get_heights(heights);
 
     // Human form pattern matching
-    if (w.form > 0) {
-        i32 form = -100;
+    if constexpr (F & term::FORM) {
+        eval::search_form(node, parent);
 
-        const form::Data list[] = {
-            form::GTR(),
-            form::SGTR(),
-            form::FRON()
-        };
+        i32 form = -100;
 
         // Stop pattern matching if we have garbage puyo
         auto mask_garbage = node.field.data[static_cast<i32>(cell::Type::GARBAGE)];
@@ -32,8 +158,8 @@ void evaluate(node::Data& node, i32 tear, i32 waste, const Weight& w)
         }
         else {
             // Find the best matching form
-            for (i32 i = 0; i < _countof(list); ++i) {
-                form = std::max(form, form::evaluate(node.field, heights, list[i]));
+            for (i32 i = 0; i < form::COUNT; ++i) {
+                form = std::max(form, node.form.score[i]);
             }
         }
 
@@ -41,53 +167,57 @@ void evaluate(node::Data& node, i32 tear, i32 waste, const Weight& w)
     }
 
     // Quiescence search
-    i32 q = INT32_MIN;
-
-    quiet::search(node.field, 3, [&] (quiet::Result quiet) {
-        i32 q_score = 0;
-
-        // Potential chain
-        q_score += quiet.chain.count * w.chain;
+    if constexpr (F & term::QUIET) {
+        i32 q = INT32_MIN;
 
-        // Trigger height
-        q_score += heights[quiet.x] * w.y;
+        if constexpr (F & term::PLAN) {
+            eval::search_plan<F>(node, parent, w);
 
-        // Key puyos needed
-        q_score += quiet.key * w.key;
+            if (node.plan.has_value()) {
+                // Following a plan, we only need the amount of puyos missing from the plan
+                // The node's quiescence results aren't computed, so its children can't reuse them
+                i32 distance = eval::get_plan_distance(node.field, node.plan->field);
+                q = node.plan->q + distance * w.key;
 
-        // Space for stretching chain
-        i32 chi = eval::get_chi(heights, quiet.x);
-        q_score += chi * w.chi;
-
-        // Remaining connection
-        auto [link_2, link_3] = eval::get_link_23(quiet.remain);
-        q_score += link_2 * w.link_2;
-        q_score += link_3 * w.link_3;
-
-        // Updates the best q score and plan
-        q = std::max(q, q_score);
-    });
+                node.quiet.valid = false;
+            }
+            else {
+                q = eval::get_quiet<F>(node, parent, heights, w);
+            }
+        }
+        else {
+            q = eval::get_quiet<F>(node, parent, heights, w);
+        }
 
-    if (q > INT32_MIN) {
-        node.score.eval += q;
+        if (q > INT32_MIN) {
+            node.score.eval += q;
+        }
     }
 
     // Field's shape
-    i32 shape = eval::get_shape(heights);
-    node.score.eval += shape * w.shape;
+    if constexpr (F & term::SHAPE) {
+        i32 shape = eval::get_shape(heights);
+        node.score.eval += shape * w.shape;
+    }
 
     // Avoids wells
-    i32 well = eval::get_well(heights);
-    node.score.eval += well * w.well;
+    if constexpr (F & term::WELL) {
+        i32 well = eval::get_well(heights);
+        node.score.eval += well * w.well;
+    }
 
     // Avoids bumps
-    i32 bump = eval::get_bump(heights);
-    node.score.eval += bump * w.bump;
+    if constexpr (F & term::BUMP) {
+        i32 bump = eval::get_bump(heights);
+        node.score.eval += bump * w.bump;
+    }
 
     // Puyo connections
-    auto [link_2, link_3] = eval::get_link_23(node.field);
-    node.score.eval += link_2 * w.link_2;
-    node.score.eval += link_3 * w.link_3;
+    if constexpr (F & term::LINK) {
+        auto [link_2, link_3] = eval::get_link_23(node.field);
+        node.score.eval += link_2 * w.link_2;
+        node.score.eval += link_3 * w.link_3;
+    }
 
     // Avoids wasting space on the 14th row
     i32 waste_14 = eval::get_waste_14(node.field.row14);
@@ -97,9 +227,11 @@ void evaluate(node::Data& node, i32 tear, i32 waste, const Weight& w)
     node.score.eval += node.field.data[static_cast<u8>(cell::Type::GARBAGE)].get_count() * w.nuisance;
 
     // Field side bias
-    i32 height_left = heights[0] + heights[1];
-    i32 height_right = heights[3] + heights[4] + heights[5];
-    node.score.eval += (std::max(height_left, height_right) - i32(heights[2])) * w.side;
+    if constexpr (F & term::SIDE) {
+        i32 height_left = heights[0] + heights[1];
+        i32 height_right = heights[3] + heights[4] + heights[5];
+        node.score.eval += (std::max(height_left, height_right) - i32(heights[2])) * w.side;
+    }
 
     // Avoids tearing
     node.score.action += tear * w.tear;
@@ -108,6 +240,206 @@ void evaluate(node::Data& node, i32 tear, i32 waste, const Weight& w)
     node.score.action += waste * w.waste;
 };
 
+// The plan term needs both form matching and the quiescence search
+// Every other set of terms drops it, so we don't compile useless versions
+constexpr u32 get_normalized(u32 terms)
+{
+    if ((terms & term::PLAN) && (!(terms & term::FORM) || !(terms & term::QUIET))) {
+        return terms & ~term::PLAN;
+    }
+
+    return terms;
+};
+
+// Table of all the specialized evaluation functions, indexed by their enabled terms
+template <u32... F>
+constexpr std::array<Function, sizeof...(F)> get_table(std::integer_sequence<u32, F...>)
+{
+    return { &eval::evaluate<eval::get_normalized(F)>... };
+};
+
+constexpr auto TABLE = eval::get_table(std::make_integer_sequence<u32, 1U << term::COUNT>());
+
+// Evaluates a node using the generic version
+void evaluate(node::Data& node, i32 tear, i32 waste, const Weight& w)
+{
+    eval::get_function(w)(node, nullptr, tear, waste, w);
+};
+
+// Fills the node's quiescence cache
+// Entries that the new puyos can't influence are inherited from the parent, the rest are simulated
+template <bool LINK>
+void search_quiet(node::Data& node, const node::Data* parent)
+{
+    auto& cache = node.quiet;
+
+    u8 heights[6];
+    node.field.get_heights(heights);
+
+    auto [x_min, x_max] = quiet::get_bound(heights);
+
+    // Finds the region influenced by the new puyos
+    // Since links are counted per group, the remaining connections of an inherited entry only change by the links gained inside the new puyos' groups
+    bool inherit = parent != nullptr && parent->quiet.valid;
+
+    FieldBit reach = FieldBit();
+    i32 link_2_delta = 0;
+    i32 link_3_delta = 0;
+
+    if (inherit) {
+        auto parent_field = parent->field;
+        FieldBit groups[cell::COUNT - 1];
+
+        reach = quiet::get_reach(node.field, parent_field, groups);
+
+        if constexpr (LINK) {
+            for (u8 p = 0; p < cell::COUNT - 1; ++p) {
+                if (groups[p].is_empty()) {
+                    continue;
+                }
+
+                FieldBit groups_pre;
+                groups_pre.data = _mm_andnot_si128(_mm_andnot_si128(parent_field.data[p].data, node.field.data[p].data), groups[p].data);
+
+                auto [link_2, link_3] = eval::get_link_23(groups[p]);
+                auto [link_2_pre, link_3_pre] = eval::get_link_23(groups_pre);
+
+                link_2_delta += link_2 - link_2_pre;
+                link_3_delta += link_3 - link_3_pre;
+            }
+        }
+    }
+
+    auto result = quiet::Cache();
+
+    // The key puyos needed are only computed when we can't inherit
+    u8 need[6][cell::COUNT - 1];
+    bool need_found = false;
+
+    for (i8 x = x_min; x <= x_max; ++x) {
+        for (u8 p = 0; p < cell::COUNT - 1; ++p) {
+            // Inherits from the parent
+            if (inherit && _mm_testz_si128(reach.data, parent->quiet.dirty[x][p].data)) {
+                result.entry[x][p] = parent->quiet.entry[x][p];
+                result.dirty[x][p] = parent->quiet.dirty[x][p];
+
+                if (result.entry[x][p].count > 0) {
+                    result.entry[x][p].link_2 += link_2_delta;
+                    result.entry[x][p].link_3 += link_3_delta;
+                }
+
+                continue;
+            }
+
+            // Simulates
+            if (!need_found) {
+                node.field.get_key_need(3, need);
+                need_found = true;
+            }
+
+            Field remain;
+
+            result.entry[x][p] = quiet::get_entry(node.field, heights, x, p, need[x][p], remain, result.dirty[x][p]);
+
+            if constexpr (LINK) {
+                if (result.entry[x][p].count > 0) {
+                    auto [link_2, link_3] = eval::get_link_23(remain);
+
+                    result.entry[x][p].link_2 = link_2;
+                    result.entry[x][p].link_3 = link_3;
+                }
+            }
+        }
+    }
+
+    result.valid = true;
+    cache = result;
+};
+
+// Matches the node's field against every pattern in form::LIST
+// If the node was created from its parent without popping, we only match the new puyos and update the parent's results
+void search_form(node::Data& node, const node::Data* parent)
+{
+    u64 planes[cell::COUNT];
+    u64 occupied = 0;
+
+    for (u8 c = 0; c < cell::COUNT; ++c) {
+        planes[c] = form::get_packed(node.field.data[c]);
+        occupied |= planes[c];
+    }
+
+    if (parent != nullptr && parent->form.valid) {
+        auto parent_field = parent->field;
+        auto parent_mask = parent_field.get_mask();
+
+        u64 added = occupied & ~form::get_packed(parent_mask);
+
+        for (i32 i = 0; i < form::COUNT; ++i) {
+            node.form.score[i] = form::accumulate(planes, added, parent->form.score[i], form::LIST[i]);
+        }
+    }
+    else {
+        for (i32 i = 0; i < form::COUNT; ++i) {
+            node.form.score[i] = form::evaluate(planes, form::LIST[i]);
+        }
+    }
+
+    node.form.valid = true;
+};
+
+// Returns the terms that have non-zero weights
+u32 get_terms(const Weight& w)
+{
+    u32 result = 0;
+
+    if (w.form > 0) {
+        result |= term::FORM;
+    }
+
+    if (w.chain != 0 || w.y != 0 || w.key != 0 || w.chi != 0 || w.link_2 != 0 || w.link_3 != 0) {
+        result |= term::QUIET;
+    }
+
+    if (w.chi != 0) {
+        result |= term::CHI;
+    }
+
+    if (w.link_2 != 0 || w.link_3 != 0) {
+        result |= term::LINK;
+    }
+
+    if (w.shape != 0) {
+        result |= term::SHAPE;
+    }
+
+    if (w.well != 0) {
+        result |= term::WELL;
+    }
+
+    if (w.bump != 0) {
+        result |= term::BUMP;
+    }
+
+    if (w.side != 0) {
+        result |= term::SIDE;
+    }
+
+    return result;
+};
+
+// Selects the precompiled evaluation function for a weight profile
+// This should be called once per search, not once per node
+Function get_function(const Weight& w, bool plan)
+{
+    u32 terms = eval::get_terms(w);
+
+    if (plan) {
+        terms |= term::PLAN;
+    }
+
+    return eval::TABLE[terms];
+};
+
 // Returns how extendable the trigger point is
 i32 get_chi(u8 heights[6], i8 x)
 {
@@ -248,29 +580,37 @@ std::pair<i32, i32> get_link_23(Field& field)
     i32 link_3 = 0;
 
     for (u8 p = 0; p < cell::COUNT - 1; ++p) {
-        __m128i m12 = field.data[p].get_mask_12().data;
+        auto [plane_2, plane_3] = eval::get_link_23(field.data[p]);
+
+        link_2 += plane_2;
+        link_3 += plane_3;
+    }
+
+    return { link_2, link_3 };
+};
 
-        __m128i r = _mm_srli_si128(m12, 2) & m12;
-        __m128i l = _mm_slli_si128(m12, 2) & m12;
-        __m128i u = _mm_srli_epi16(m12, 1) & m12;
-        __m128i d = _mm_slli_epi16(m12, 1) & m12;
+// Returns the number of 2-connected and 3-connected links of 1 color
+std::pair<i32, i32> get_link_23(FieldBit& plane)
+{
+    __m128i m12 = plane.get_mask_12().data;
 
-        __m128i ud_and = u & d;
-        __m128i lr_and = l & r;
-        __m128i ud_or = u | d;
-        __m128i lr_or = l | r;
+    __m128i r = _mm_srli_si128(m12, 2) & m12;
+    __m128i l = _mm_slli_si128(m12, 2) & m12;
+    __m128i u = _mm_srli_epi16(m12, 1) & m12;
+    __m128i d = _mm_slli_epi16(m12, 1) & m12;
 
-        FieldBit l3;
-        FieldBit l2;
+    __m128i ud_and = u & d;
+    __m128i lr_and = l & r;
+    __m128i ud_or = u | d;
+    __m128i lr_or = l | r;
 
-        l3.data = (ud_or & lr_or) | ud_and | lr_and;
-        l2.data = _mm_andnot_si128(l3.get_expand().data, u | l);
+    FieldBit l3;
+    FieldBit l2;
 
-        link_2 += l2.get_count();
-        link_3 += l3.get_count();
-    }
+    l3.data = (ud_or & lr_or) | ud_and | lr_and;
+    l2.data = _mm_andnot_si128(l3.get_expand().data, u | l);
 
-    return { link_2, link_3 };
+    return { l2.get_count(), l3.get_count() };
 };
 
 // Returns the remaining reachable cells left on the 14th row
@@ -54,8 +54,48 @@ NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(Weight,
     waste
 )
 
+// Evaluation terms that are expensive to compute
+// Each precompiled evaluation function only computes the terms that have non-zero weights
+namespace term
+{
+
+constexpr u32 FORM = 1 << 0;
+constexpr u32 QUIET = 1 << 1;
+constexpr u32 CHI = 1 << 2;
+constexpr u32 LINK = 1 << 3;
+constexpr u32 SHAPE = 1 << 4;
+constexpr u32 WELL = 1 << 5;
+constexpr u32 BUMP = 1 << 6;
+constexpr u32 SIDE = 1 << 7;
+constexpr u32 PLAN = 1 << 8;
+
+constexpr u32 COUNT = 9;
+
+};
+
+typedef void (*Function)(node::Data& node, const node::Data* parent, i32 tear, i32 waste, const Weight& w);
+
 void evaluate(node::Data& node, i32 tear, i32 waste, const Weight& w);
 
+template <bool LINK>
+void search_quiet(node::Data& node, const node::Data* parent);
+
+void search_form(node::Data& node, const node::Data* parent);
+
+template <u32 F>
+void search_plan(node::Data& node, const node::Data* parent, const Weight& w);
+
+template <u32 F>
+i32 get_quiet(node::Data& node, const node::Data* parent, u8 heights[6], const Weight& w);
+
+bool is_on_plan(const Field& field, const Field& plan);
+
+i32 get_plan_distance(Field& field, Field& plan);
+
+u32 get_terms(const Weight& w);
+
+Function get_function(const Weight& w, bool plan = false);
+
 i32 get_chi(u8 heights[6], i8 x);
 
 i32 get_shape(u8 heights[6]);
@@ -70,6 +110,8 @@ i32 get_link(Field& field);
 
 std::pair<i32, i32> get_link_23(Field& field);
 
+std::pair<i32, i32> get_link_23(FieldBit& plane);
+
 i32 get_waste_14(u8 row14);
 
 };
@@ -6,99 +6,204 @@ namespace beam
 namespace form
 {
 
-// Human pattern matching
-i32 evaluate(Field& field, u8 height[6], const Data& pattern)
+// Compiles a pattern into bitboards
+Pattern compile(const Data& data)
 {
-    i32 result = 0;
-    const i32 error = -100;
+    Pattern result = Pattern();
 
-    for (i8 x0 = 0; x0 < 6; ++x0) {
-        for (i8 y0 = 0; y0 < HEIGHT; ++y0) {
-            if (height[x0] <= y0) {
-                break;
+    for (i8 x = 0; x < 6; ++x) {
+        for (i8 y = 0; y < HEIGHT; ++y) {
+            u8 label = data.form[y][x];
+
+            if (label == 0) {
+                continue;
             }
 
-            if (pattern.form[y0][x0] == 0) {
+            result.mask[label] |= 1ULL << (x * HEIGHT + y);
+            result.label[x * HEIGHT + y] = label;
+            result.label_count = std::max<u8>(result.label_count, label + 1);
+        }
+    }
+
+    for (u8 a = 1; a < result.label_count; ++a) {
+        for (u8 b = a; b < result.label_count; ++b) {
+            if (data.matrix[a][b] == 0 || result.mask[a] == 0 || result.mask[b] == 0) {
                 continue;
             }
 
-            for (i8 x1 = x0; x1 < 6; ++x1) {
-                for (i8 y1 = 0; y1 < HEIGHT; ++y1) {
-                    if (height[x1] <= y1) {
-                        break;
-                    }
+            result.relations[result.relation_count] = Pattern::Relation { a, b, data.matrix[a][b] };
+            result.relation_count += 1;
+        }
+    }
 
-                    if (pattern.form[y1][x1] == 0) {
-                        continue;
-                    }
+    return result;
+};
 
-                    if (x0 == x1 && y0 >= y1) {
-                        continue;
-                    }
+// Packs the cells under HEIGHT of a bitboard into a u64, HEIGHT bits per column
+u64 get_packed(FieldBit& bitboard)
+{
+    alignas(16) u16 v[8];
+    _mm_store_si128((__m128i*)v, bitboard.data);
 
-                    i8 field_rel = i8(field.get_cell(x0, y0) == field.get_cell(x1, y1)) * 2 - 1;
-                    i8 pattern_rel = pattern.matrix[pattern.form[y0][x0]][pattern.form[y1][x1]];
+    u64 result = 0;
 
-                    if (pattern_rel != 0) {
-                        if (field_rel * pattern_rel > 0) {
-                            result += field_rel * pattern_rel;
-                        }
-                        else {
-                            return error;
-                        }
-                    }
-                }
+    for (i32 x = 0; x < 6; ++x) {
+        result |= u64(v[x] & ((1U << HEIGHT) - 1)) << (x * HEIGHT);
+    }
+
+    return result;
+};
+
+// Human pattern matching
+// For every label, we count the puyos of each color on its cells
+// Then every pair of puyos in 2 related labels is checked at once:
+// - if the labels must be the same color, every pair must have the same color and each one scores the relation's value
+// - if the labels must be different colors, no pair can have the same color and each one scores minus the relation's value
+// Returns an error if any pair breaks its relation
+// The field's planes are given packed
+i32 evaluate(u64 planes[cell::COUNT], const Pattern& pattern)
+{
+    const i32 error = -100;
+
+    i32 counts[AREA][cell::COUNT];
+    i32 totals[AREA];
+
+    for (u8 label = 1; label < pattern.label_count; ++label) {
+        totals[label] = 0;
+
+        for (u8 c = 0; c < cell::COUNT; ++c) {
+            counts[label][c] = std::popcount(pattern.mask[label] & planes[c]);
+            totals[label] += counts[label][c];
+        }
+    }
+
+    i32 result = 0;
+
+    for (i32 i = 0; i < pattern.relation_count; ++i) {
+        auto& relation = pattern.relations[i];
+
+        // Counts the pairs of puyos with the same color and the pairs in total
+        i32 same = 0;
+        i32 total = 0;
+
+        if (relation.a == relation.b) {
+            for (u8 c = 0; c < cell::COUNT; ++c) {
+                same += counts[relation.a][c] * (counts[relation.a][c] - 1) / 2;
             }
+
+            total = totals[relation.a] * (totals[relation.a] - 1) / 2;
+        }
+        else {
+            for (u8 c = 0; c < cell::COUNT; ++c) {
+                same += counts[relation.a][c] * counts[relation.b][c];
+            }
+
+            total = totals[relation.a] * totals[relation.b];
+        }
+
+        if (relation.value > 0) {
+            if (same != total) {
+                return error;
+            }
+
+            result += total * relation.value;
+        }
+        else {
+            if (same != 0) {
+                return error;
+            }
+
+            result -= total * relation.value;
         }
     }
 
     return result;
 };
 
+// Human pattern matching
+i32 evaluate(Field& field, const Pattern& pattern)
+{
+    u64 planes[cell::COUNT];
+
+    for (u8 c = 0; c < cell::COUNT; ++c) {
+        planes[c] = form::get_packed(field.data[c]);
+    }
+
+    return form::evaluate(planes, pattern);
+};
+
+// Human pattern matching
+// Compiles the pattern first, prefer compiling the pattern once then calling evaluate() with it
+i32 evaluate(Field& field, u8 height[6], const Data& pattern)
+{
+    return form::evaluate(field, form::compile(pattern));
+};
+
 // Pattern matching
-// But instead of checking the whole field, we only check 2 new puyo blobs at a time
-i32 accumulate(Field& field, u8 height[6], i8 x_check[2], i8 y_check[2], const Data& pattern)
+// But instead of checking the whole field, we only check the new puyos given in "added" and update the previous score
+// The new puyos are added one by one, and each one is paired with the puyos that were there before it
+// This way every pair is counted exactly once, including the pair of the 2 puyos of a new pair
+// Failing is final, since adding puyos never removes a broken pair
+i32 accumulate(u64 planes[cell::COUNT], u64 added, i32 score, const Pattern& pattern)
 {
-    i32 result = 0;
     const i32 error = -100;
 
-    for (i8 x = 0; x < 6; ++x) {
-        for (i8 y = 0; y < HEIGHT; ++y) {
-            if (height[x] <= y) {
-                break;
-            }
+    if (score == error) {
+        return error;
+    }
 
-            if (pattern.form[y][x] == 0) {
-                continue;
-            }
+    u64 known = 0;
 
-            auto cell = field.get_cell(x, y);
+    for (u8 c = 0; c < cell::COUNT; ++c) {
+        known |= planes[c];
+    }
 
-            for (auto i = 0; i < 2; ++i) {
-                if (pattern.form[y_check[i]][x_check[i]] == 0) {
-                    continue;
-                }
+    known &= ~added;
 
-                if (x == x_check[i] && y >= y_check[i]) {
-                    continue;
-                }
+    for (u8 c = 0; c < cell::COUNT; ++c) {
+        u64 bits = planes[c] & added;
+
+        while (bits != 0) {
+            u64 bit = bits & (~bits + 1);
+            bits &= bits - 1;
+
+            u8 label = pattern.label[std::countr_zero(bit)];
 
-                i8 field_rel = i8(cell == field.get_cell(x_check[i], y_check[i])) * 2 - 1;
-                i8 pattern_rel = pattern.matrix[pattern.form[y][x]][pattern.form[y_check[i]][x_check[i]]];
+            if (label != 0) {
+                for (i32 i = 0; i < pattern.relation_count; ++i) {
+                    auto& relation = pattern.relations[i];
 
-                if (pattern_rel != 0) {
-                    if (field_rel * pattern_rel > 0) {
-                        result += field_rel * pattern_rel;
+                    if (relation.a != label && relation.b != label) {
+                        continue;
+                    }
+
+                    u8 other = relation.a == label ? relation.b : relation.a;
+
+                    i32 same = std::popcount(pattern.mask[other] & planes[c] & known);
+                    i32 total = std::popcount(pattern.mask[other] & known);
+
+                    if (relation.value > 0) {
+                        if (same != total) {
+                            return error;
+                        }
+
+                        score += total * relation.value;
                     }
                     else {
-                        return error;
+                        if (same != 0) {
+                            return error;
+                        }
+
+                        score -= total * relation.value;
                     }
                 }
             }
+
+            known |= bit;
         }
     }
 
-    return result;
+    return score;
 };
 
 Field get_plan(Field& field, const Data& pattern)
@@ -149,6 +254,74 @@ Field get_plan(Field& field, const Data& pattern)
     return result;
 };
 
+// Completes the field following a compiled pattern
+// Same as the Data version
+Field get_plan(Field& field, const Pattern& pattern)
+{
+    Field result = field;
+
+    // Only labels that must be the same color can be filled
+    bool fillable[AREA] = { false };
+
+    for (i32 i = 0; i < pattern.relation_count; ++i) {
+        if (pattern.relations[i].a == pattern.relations[i].b) {
+            fillable[pattern.relations[i].a] = true;
+        }
+    }
+
+    cell::Type map[AREA];
+
+    for (i32 i = 0; i < AREA; ++i) {
+        map[i] = cell::Type::NONE;
+    }
+
+    for (i32 x = 0; x < 6; ++x) {
+        for (i32 y = 0; y < HEIGHT; ++y) {
+            u8 label = pattern.label[x * HEIGHT + y];
+
+            if (label == 0 || !fillable[label] || map[label] != cell::Type::NONE) {
+                continue;
+            }
+
+            auto field_cell = result.get_cell(x, y);
+
+            if (field_cell == cell::Type::NONE) {
+                continue;
+            }
+
+            map[label] = field_cell;
+        }
+    }
+
+    for (i32 x = 0; x < 6; ++x) {
+        for (i32 y = 0; y < HEIGHT; ++y) {
+            u8 label = pattern.label[x * HEIGHT + y];
+
+            if (label == 0) {
+                break;
+            }
+
+            if (result.get_cell(x, y) != cell::Type::NONE) {
+                continue;
+            }
+
+            if (map[label] == cell::Type::NONE) {
+                break;
+            }
+
+            result.set_cell(x, y, map[label]);
+        }
+    }
+
+    return result;
+};
+
+const Pattern LIST[COUNT] = {
+    form::compile(form::GTR()),
+    form::compile(form::SGTR()),
+    form::compile(form::FRON())
+};
+
 };
 
 };
\ No newline at end of file
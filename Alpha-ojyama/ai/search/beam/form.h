@@ -17,12 +17,42 @@ struct Data
     i8 matrix[AREA][AREA] = { 0 };
 };
 
+// A pattern compiled into bitboards
+// Every label's cells are packed into a u64 with HEIGHT bits per column
+// The non-zero relations between labels are listed once, so matching only takes a few AND and POPCNT per label and color
+// The pattern's matrix is expected to be symmetric
+struct Pattern
+{
+    struct Relation
+    {
+        u8 a;
+        u8 b;
+        i8 value;
+    };
+
+    u64 mask[AREA] = { 0 };
+    u8 label[AREA] = { 0 };
+    u8 label_count = 0;
+    Relation relations[AREA * (AREA + 1) / 2] = {};
+    i32 relation_count = 0;
+};
+
+Pattern compile(const Data& data);
+
+u64 get_packed(FieldBit& bitboard);
+
+i32 evaluate(u64 planes[cell::COUNT], const Pattern& pattern);
+
+i32 evaluate(Field& field, const Pattern& pattern);
+
 i32 evaluate(Field& field, u8 height[6], const Data& pattern);
 
-i32 accumulate(Field& field, u8 height[6], i8 x_check[2], i8 y_check[2], const Data& pattern);
+i32 accumulate(u64 planes[cell::COUNT], u64 added, i32 score, const Pattern& pattern);
 
 Field get_plan(Field& field, const Data& pattern);
 
+Field get_plan(Field& field, const Pattern& pattern);
+
 constexpr Data GTR()
 {
     Data pattern = { 0 };
@@ -188,6 +218,19 @@ constexpr Data MERI()
     return pattern;
 };
 
+// The patterns matched in beam search
+constexpr i32 COUNT = 3;
+
+extern const Pattern LIST[COUNT];
+
+// The matching results of a node for every pattern in LIST
+// A node created without popping updates its parent's results with only the new puyos
+struct State
+{
+    i32 score[COUNT] = { 0 };
+    bool valid = false;
+};
+
 };
 
 };
\ No newline at end of file
@@ -2,6 +2,8 @@
 
 #include "../../../core/core.h"
 #include "../../../lib/rapidhash/rapidhash.h"
+#include "quiet.h"
+#include "form.h"
 
 namespace beam
 {
@@ -15,11 +17,30 @@ struct Score
     i32 action = 0;
 };
 
+// The completed field of the template the node is following, see Configs::plan
+// "q" is the quiescence value of the completed field
+struct Plan
+{
+    Field field = Field();
+    i32 q = INT32_MIN;
+};
+
+// The total score and frames of the chains triggered on the path to the node, see attack::search()
+struct Sent
+{
+    i32 score = 0;
+    i32 frame = 0;
+};
+
 struct Data
 {
     Field field = Field();
     Score score = Score();
     i32 index = -1;
+    quiet::Cache quiet = quiet::Cache();
+    form::State form = form::State();
+    std::optional<Plan> plan = std::nullopt;
+    Sent sent = Sent();
 };
 
 inline bool operator < (const Score& a, const Score& b)
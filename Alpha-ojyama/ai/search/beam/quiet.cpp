@@ -6,88 +6,91 @@ namespace beam
 namespace quiet
 {
 
-// Searches all the potential chain extensions of the field
-void search(
-    Field& field,
-    i32 drop,
-    std::function<void(Result)> callback
-)
+// Drops the key puyos of color p on column x found by Field::get_key_need(), then simulates the chain
+// Returns the remaining field after the chain in "remain"
+// Returns in "dirty" every cell that the simulation could have changed:
+// - the key puyos' column from the trigger height
+// - every column from the lowest popped puyo (or popped garbage) upward, because everything above it fell
+//
+// Ex:
+// Dropping 1 blue on the 3rd column pops the blues and the reds above them fall
+// ......    ......    ..XX..
+// ..R...    ..B...    ..XX..
+// .RB... -> .RB... -> ..XX..
+// .BB...    .BBR..    .XXX..
+// GGY...    GGYR..    XXXX..
+Entry get_entry(Field& field, u8 heights[6], i8 x, u8 p, i8 need, Field& remain, FieldBit& dirty)
 {
-    u8 heights[6];
-    field.get_heights(heights);
-
-    auto [x_min, x_max] = quiet::get_bound(heights);
-
-    // Drops puyo until a chain is triggered for all columns and colors
-    quiet::generate(
-        field,
-        x_min,
-        x_max,
-        drop,
-        [&] (i8 x, i8 p, i8 need) {
-            // Drops puyo
-            auto plan = field;
-
-            for (i32 i = 0; i < need; ++i) {
-                plan.data[p].set_bit(x, heights[x] + i);
-            }
+    auto entry = Entry();
 
-            // Pops field
-            auto pop = plan.pop();
-
-            // Checks for callback
-            if (pop.get_size() > 1) {
-                auto chain = chain::get_score(pop);
-
-                callback(Result {
-                    .chain = chain::Score {
-                        .count = chain.count,
-                        .score = chain.score
-                    },
-                    .x = x,
-                    .key = need,
-                    .remain = plan
-                });
-            }
+    FieldBit changed = FieldBit();
+    changed.set_bit(x, std::min(i32(heights[x]), 12));
+
+    // Simulates the chain
+    if (need > 0) {
+        remain = field;
+
+        for (i32 i = 0; i < need; ++i) {
+            remain.data[p].set_bit(x, heights[x] + i);
+        }
+
+        auto pop = remain.pop();
+
+        for (i32 i = 0; i < pop.get_size(); ++i) {
+            changed = changed | pop[i].get_mask().get_expand();
+        }
+
+        if (pop.get_size() > 1) {
+            entry.count = i8(pop.get_size());
+            entry.key = need;
         }
-    );
+    }
+
+    // Fills every column from its lowest changed cell upward
+    __m128i low = _mm_and_si128(changed.data, _mm_sub_epi16(_mm_setzero_si128(), changed.data));
+    dirty.data = _mm_andnot_si128(_mm_sub_epi16(low, _mm_set1_epi16(1)), _mm_set1_epi16(-1));
+
+    return entry;
 };
 
-// Finds dropping positions that may trigger a chain
-void generate(
-    Field& field,
-    i8 x_min,
-    i8 x_max,
-    i32 drop,
-    std::function<void(i8, i8, i8)> callback
-)
+// Returns the region that the puyos added since the parent field could influence
+// That is the new puyos and the neighbors of the groups they are part of
+// If this region doesn't touch the dirty region of a parent's entry, the simulation of that entry gives the same chain in the child, and the new puyos just stay where they are
+// Returns each color's groups containing the new puyos in "groups"
+FieldBit get_reach(Field& field, Field& parent, FieldBit groups[cell::COUNT - 1])
 {
-    u8 heights[6];
-    field.get_heights(heights);
+    FieldBit result = FieldBit();
+
+    for (u8 p = 0; p < cell::COUNT - 1; ++p) {
+        groups[p] = FieldBit();
 
-    for (i8 x = x_min; x <= x_max; ++x) {
-        // Finds the maximum amount of puyo blobs that can be drop
-        i32 drop_max = std::min(drop, 12 - i32(heights[x]));
+        FieldBit added;
+        added.data = _mm_andnot_si128(parent.data[p].data, field.data[p].data);
 
-        if (drop_max <= 0) {
+        if (added.is_empty()) {
             continue;
         }
 
-        // For every color
-        for (u8 p = 0; p < cell::COUNT - 1; ++p) {
-            auto copy = field;
+        __m128i m12 = field.data[p].get_mask_12().data;
 
-            // Continues dropping puyo blobs until we trigger a chain
-            for (i8 i = 0; i < drop_max; ++i) {
-                copy.data[p].set_bit(x, heights[x] + i);
+        FieldBit group = added.get_mask_12();
 
-                if (copy.data[p].get_mask_group_4(x, heights[x]).get_count() >= 4) {
-                    callback(x, p, i + 1);
-                    break;
-                }
+        while (true)
+        {
+            __m128i group_expand = group.get_expand().data & m12;
+
+            if (_mm_testc_si128(group.data, group_expand)) {
+                break;
             }
+
+            group.data = group_expand;
         }
+
+        groups[p] = group;
+        result = result | added | group.get_expand();
     }
+
+    return result;
 };
 
 // Gets the dropping bound
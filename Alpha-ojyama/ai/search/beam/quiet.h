@@ -16,21 +16,105 @@ struct Result
     Field remain = Field();
 };
 
-void search(
-    Field& field,
-    i32 drop,
-    std::function<void(Result)> callback
-);
+// The result of dropping key puyos of 1 color on 1 column
+// A count of 0 means no chain was found
+struct Entry
+{
+    i8 count = 0;
+    i8 key = 0;
+    i16 link_2 = 0;
+    i16 link_3 = 0;
+};
+
+// Quiescence results of a node for every column and color
+// Each entry also keeps the region of the field that was changed while simulating it
+// When a child is created without popping, the entries whose region doesn't touch the new puyos are inherited from the parent instead of being simulated again
+// The cache is kept inline in node::Data, copying it with the node is cheaper than the simulations it saves
+struct Cache
+{
+    Entry entry[6][cell::COUNT - 1] = {};
+    FieldBit dirty[6][cell::COUNT - 1] = {};
+    bool valid = false;
+};
 
-void generate(
+Entry get_entry(Field& field, u8 heights[6], i8 x, u8 p, i8 need, Field& remain, FieldBit& dirty);
+
+FieldBit get_reach(Field& field, Field& parent, FieldBit groups[cell::COUNT - 1]);
+
+std::pair<i8, i8> get_bound(u8 heights[6]);
+
+// Finds dropping positions that may trigger a chain
+// The callback is called with (x, color, key puyos needed) for every trigger found
+template <typename T>
+inline void generate(
     Field& field,
     i8 x_min,
     i8 x_max,
     i32 drop,
-    std::function<void(i8, i8, i8)> callback
-);
+    T&& callback
+)
+{
+    u8 need[6][cell::COUNT - 1];
+    field.get_key_need(drop, need);
 
-std::pair<i8, i8> get_bound(u8 heights[6]);
+    for (i8 x = x_min; x <= x_max; ++x) {
+        // For every color
+        for (u8 p = 0; p < cell::COUNT - 1; ++p) {
+            if (need[x][p] > 0) {
+                callback(x, p, need[x][p]);
+            }
+        }
+    }
+};
+
+// Searches all the potential chain extensions of the field
+// The callback is called with a Result for every potential chain found
+template <typename T>
+inline void search(
+    Field& field,
+    i32 drop,
+    T&& callback
+)
+{
+    u8 heights[6];
+    field.get_heights(heights);
+
+    auto [x_min, x_max] = quiet::get_bound(heights);
+
+    // Drops puyo until a chain is triggered for all columns and colors
+    quiet::generate(
+        field,
+        x_min,
+        x_max,
+        drop,
+        [&] (i8 x, i8 p, i8 need) {
+            // Drops puyo
+            auto plan = field;
+
+            for (i32 i = 0; i < need; ++i) {
+                plan.data[p].set_bit(x, heights[x] + i);
+            }
+
+            // Pops field
+            auto pop = plan.pop();
+
+            // Checks for callback
+            if (pop.get_size() > 1) {
+                auto chain = chain::get_score(pop);
+
+                callback(Result {
+                    .chain = chain::Score {
+                        .count = chain.count,
+                        .score = chain.score
+                    },
+                    .x = x,
+                    .key = need,
+                    .remain = plan
+                });
+            }
+        }
+    );
+};
 
 };
 
@@ -7,12 +7,19 @@ namespace attack
 {
 
 // Searches for all possible attacks
+// If "keep" isn't 0, each candidate only keeps its best attacks, see Collector
+// The first 2 placements are split into tasks on the caller's work-stealing pool, each second placement collecting into its own collection
+// The tasks are in their own group, so the pool can be shared with other searches running at the same time
+// The collections are merged in placement order after the tasks are done, so the attacks are in the same order as in a sequential search
+// If "path" is set, the attacks' frames also count the real input frames of the placements, see path::Finder::get_frames()
 Result search(
     Field field,
     cell::Queue queue,
+    Pool& pool,
     bool detect,
     i32 frame_delay,
-    i32 thread_count
+    size_t keep,
+    bool path
 )
 {
     if (queue.size() < 2) {
@@ -31,109 +38,126 @@ Result search(
     // Generates placements
     auto placements = move::generate(field, queue[0].first == queue[0].second);
 
-    // Divides the works among the threads
-    std::mutex mtx;
-    std::vector<std::thread> threads;
-
-    for (i32 t = 0; t < thread_count; ++t) {
-        threads.emplace_back([&] () {
-            while (true)
-            {
-                move::Placement placement;
-
-                // Locks mutex and takes 1 placements from the placements list above
-                {
-                    std::lock_guard<std::mutex> lk(mtx);
-                    if (placements.get_size() < 1) {
-                        break;
-                    }
-                    placement = placements[placements.get_size() - 1];
-                    placements.pop();
-                }
-
-                // Creates candidate
-                Candidate candidate = Candidate {
-                    .placement = placement,
-                    .attack_max = attack::Data(),
-                    .attacks = std::vector<attack::Data>(),
-                    .attacks_ac = std::vector<attack::Data>(),
-                    .attacks_detect = std::vector<attack::Data>()
-                };
-
-                candidate.attacks.reserve(512);
-                candidate.attacks_detect.reserve(512);
-
-                // Creates child node
-                auto child = root;
-
-                child.field.drop_pair(placement.x, placement.r, queue[0]);
-                auto mask_pop = child.field.pop();
-
-                // Checks for death
-                if (child.field.get_height(2) > 11) {
-                    continue;
-                }
-
-                // Gets chain score
-                auto chain = chain::get_score(mask_pop);
-
-                if (chain.count > 0) {
-                    // Pushes attack to the candidate
-                    auto attack = attack::Data {
-                        .count = chain.count,
-                        .score = chain.score,
-                        .score_total = chain.score,
-                        .frame = 0,
-                        .frame_real = root.field.get_drop_pair_frame(placement.x, placement.r),
-                        .all_clear = child.field.is_empty(),
-                        .redundancy = INT32_MAX,
-                        .link = eval::get_link(child.field),
-                        .parent = root.field,
-                        .result = child.field
-                    };
-
-                    candidate.attacks.push_back(attack);
-
-                    // Checks for all clear
-                    if (attack.all_clear) {
-                        candidate.attacks_ac.push_back(attack);
+    path::Frames frames;
+
+    if (path) {
+        frames = path::Finder::get_frames(field, queue[0].first == queue[0].second);
+    }
+
+    // The search's states of the first placements and their second placements
+    struct Split
+    {
+        Candidate candidate;
+        Collection collection;
+    };
+
+    struct Branch
+    {
+        Split root;
+        std::optional<Node> child;
+        avec<move::Placement, 22> placements;
+        path::Frames frames;
+        std::vector<Split> splits;
+    };
+
+    auto create_split = [&] (move::Placement placement) {
+        return Split {
+            .candidate = Candidate {
+                .placement = placement,
+                .attack_max = attack::Data(),
+                .attacks = std::vector<attack::Data>(),
+                .attacks_ac = std::vector<attack::Data>(),
+                .attacks_detect = std::vector<attack::Data>()
+            },
+            .collection = Collection {
+                .attacks = Collector(keep),
+                .attacks_ac = Collector(keep),
+                .attacks_detect = Collector(keep)
+            }
+        };
+    };
+
+    std::vector<Branch> branches(placements.get_size());
+
+    Pool::Group group;
+
+    for (i32 i = 0; i < placements.get_size(); ++i) {
+        pool.submit([&, i] () {
+            auto& branch = branches[i];
+
+            branch.root = create_split(placements[i]);
+
+            if (keep == 0) {
+                branch.root.collection.attacks.data.reserve(512);
+                branch.root.collection.attacks_detect.data.reserve(512);
+            }
+
+            // Creates child node
+            branch.child = attack::expand(root, placements[i], queue[0], branch.root.candidate, branch.root.collection, frame_delay, path ? &frames : nullptr);
+
+            if (!branch.child) {
+                return;
+            }
+
+            // Splits the search of every second placement into its own task
+            branch.placements = move::generate(branch.child->field, queue[1].first == queue[1].second);
+
+            if (path) {
+                branch.frames = path::Finder::get_frames(branch.child->field, queue[1].first == queue[1].second);
+            }
+
+            for (i32 k = 0; k < branch.placements.get_size(); ++k) {
+                branch.splits.push_back(create_split(placements[i]));
+            }
+
+            for (i32 k = 0; k < branch.placements.get_size(); ++k) {
+                pool.submit([&, i, k] () {
+                    auto& branch = branches[i];
+                    auto& split = branch.splits[k];
+
+                    auto grandchild = attack::expand(*branch.child, branch.placements[k], queue[1], split.candidate, split.collection, frame_delay, path ? &branch.frames : nullptr);
+
+                    if (!grandchild) {
+                        return;
                     }
 
-                    // Updates max attack
-                    candidate.attack_max = attack;
-                }
-
-                // Accumulates stats
-                child.score += chain.score;
-                child.frame += root.field.get_drop_pair_frame(placement.x, placement.r) + chain.count * 2 + frame_delay;
-
-                // Continues searching
-                attack::dfs(
-                    child,
-                    queue,
-                    candidate,
-                    1,
-                    detect,
-                    frame_delay
-                );
-
-                // Dead end
-                if (candidate.attacks.empty()) {
-                    continue;
-                }
-
-                // Locks mutex and pushes candidate
-                {
-                    std::lock_guard<std::mutex> lk(mtx);
-                    result.candidates.push_back(candidate);
-                }
+                    attack::visit(*grandchild, queue, split.candidate, split.collection, 2, detect, frame_delay, path);
+                }, &group);
             }
-        });
+        }, &group);
     }
 
-    // Joins all threads
-    for (auto& t : threads) {
-        t.join();
+    pool.wait(group);
+
+    // Merges the results
+    for (auto& branch : branches) {
+        if (!branch.child) {
+            continue;
+        }
+
+        auto& candidate = branch.root.candidate;
+        auto& collection = branch.root.collection;
+
+        for (auto& split : branch.splits) {
+            collection.attacks.merge(split.collection.attacks);
+            collection.attacks_ac.merge(split.collection.attacks_ac);
+            collection.attacks_detect.merge(split.collection.attacks_detect);
+
+            if (attack::cmp_main(candidate.attack_max, split.candidate.attack_max)) {
+                candidate.attack_max = split.candidate.attack_max;
+            }
+        }
+
+        candidate.attacks = collection.attacks.get();
+        candidate.attacks_ac = collection.attacks_ac.get();
+        candidate.attacks_detect = collection.attacks_detect.get();
+
+        // Dead end
+        if (candidate.attacks.empty()) {
+            continue;
+        }
+
+        result.candidates.push_back(std::move(candidate));
     }
 
     return result;
@@ -144,98 +168,314 @@ void dfs(
     Node& node,
     cell::Queue& queue,
     Candidate& candidate,
+    Collection& collection,
     i32 depth,
     bool detect,
-    i32 frame_delay
+    i32 frame_delay,
+    bool path
 )
 {
     // Generates possible placements
     auto placements = move::generate(node.field, queue[depth].first == queue[depth].second);
 
+    path::Frames frames;
+
+    if (path) {
+        frames = path::Finder::get_frames(node.field, queue[depth].first == queue[depth].second);
+    }
+
     for (i32 i = 0; i < placements.get_size(); ++i) {
         // Creates child
-        auto child = node;
-        child.field.drop_pair(placements[i].x, placements[i].r, queue[depth]);
-        auto mask_pop = child.field.pop();
+        auto child = attack::expand(node, placements[i], queue[depth], candidate, collection, frame_delay, path ? &frames : nullptr);
 
-        // Checks for death
-        if (child.field.get_height(2) > 11) {
+        if (!child) {
             continue;
         }
 
-        // Gets chain score
-        auto chain = chain::get_score(mask_pop);
-
-        if (chain.count > 0) {
-            // Pushes attack
-            auto attack = attack::Data {
-                .count = chain.count,
-                .score = chain.score,
-                .score_total = child.score + chain.score,
-                .frame = child.frame,
-                .frame_real = child.frame + node.field.get_drop_pair_frame(placements[i].x, placements[i].r),
-                .all_clear = child.field.is_empty(),
-                .redundancy = INT32_MAX,
-                .link = eval::get_link(child.field),
-                .parent = node.field,
-                .result = child.field
-            };
-
-            candidate.attacks.push_back(attack);
-
-            // Checks all clear
-            if (attack.all_clear) {
-                candidate.attacks_ac.push_back(attack);
-            }
+        attack::visit(*child, queue, candidate, collection, depth + 1, detect, frame_delay, path);
+    }
+};
+
+// Places a pair on a node's field, collects the attack it triggers and updates the stats
+// If "frames" is set, the placement's input frames are added to the frames spent
+// Returns nothing if we die
+std::optional<Node> expand(
+    Node& node,
+    move::Placement placement,
+    cell::Pair pair,
+    Candidate& candidate,
+    Collection& collection,
+    i32 frame_delay,
+    path::Frames* frames
+)
+{
+    auto child = node;
+    child.field.drop_pair(placement.x, placement.r, pair);
+    auto mask_pop = child.field.pop();
+
+    // Checks for death
+    if (child.field.get_height(2) > 11) {
+        return {};
+    }
 
-            // Updates max attack
-            candidate.attack_max = std::max(
-                candidate.attack_max,
-                attack,
-                attack::cmp_main
-            );
+    // Gets the frames spent placing the pair
+    i32 frame = node.field.get_drop_pair_frame(placement.x, placement.r);
+
+    if (frames != nullptr) {
+        frame += frames->get(placement) - 1;
+    }
+
+    // Gets chain score
+    auto chain = chain::get_score(mask_pop);
+
+    if (chain.count > 0) {
+        // Pushes attack
+        auto attack = attack::Data {
+            .count = chain.count,
+            .score = chain.score,
+            .score_total = child.score + chain.score,
+            .frame = child.frame,
+            .frame_real = child.frame + frame,
+            .all_clear = child.field.is_empty(),
+            .redundancy = INT32_MAX,
+            .link = eval::get_link(child.field)
+        };
+
+        auto fill = [&] (attack::Data& a) {
+            a.parent = node.field;
+            a.result = child.field;
+        };
+
+        collection.attacks.add(attack, fill);
+
+        // Checks all clear
+        if (attack.all_clear) {
+            collection.attacks_ac.add(attack, fill);
         }
 
-        // Updates stats
-        child.score += chain.score;
-        child.frame += node.field.get_drop_pair_frame(placements[i].x, placements[i].r) + chain.count * 2 + frame_delay;
-
-        if (depth + 1 < queue.size()) {
-            // Continues searching if we are not at the end of the queue
-            attack::dfs(
-                child,
-                queue,
-                candidate,
-                depth + 1,
-                detect,
-                frame_delay
-            );
+        // Updates max attack
+        if (attack::cmp_main(candidate.attack_max, attack)) {
+            candidate.attack_max = attack;
+            fill(candidate.attack_max);
         }
-        else {
-            // If we are at the end of the queue and we want to search further
-            if (detect) {
-                quiet::search(child.field, 1, 2, [&] (quiet::Result q) {
-                    auto plan_pop = q.plan;
-                    plan_pop.pop();
-
-                    candidate.attacks_detect.push_back(attack::Data {
-                        .count = q.chain.count,
-                        .score = q.chain.score,
-                        .score_total = child.score + q.chain.score,
-                        .frame = child.frame + q.plan.get_height(q.x) - child.field.get_height(q.x),
-                        .frame_real = child.frame + 1 + q.plan.get_height(q.x) - child.field.get_height(q.x),
-                        .all_clear = false,
-                        .redundancy = INT32_MAX,
-                        .link = eval::get_link(plan_pop),
-                        .parent = child.field,
-                        .result = plan_pop
-                    });
-                });
-            }
+    }
+
+    // Updates stats
+    child.score += chain.score;
+    child.frame += frame + chain.count * 2 + frame_delay;
+
+    return child;
+};
+
+// Searches further from a node at this depth
+void visit(
+    Node& node,
+    cell::Queue& queue,
+    Candidate& candidate,
+    Collection& collection,
+    i32 depth,
+    bool detect,
+    i32 frame_delay,
+    bool path
+)
+{
+    if (depth < queue.size()) {
+        // Continues searching if we are not at the end of the queue
+        attack::dfs(
+            node,
+            queue,
+            candidate,
+            collection,
+            depth,
+            detect,
+            frame_delay,
+            path
+        );
+        return;
+    }
+
+    // If we are at the end of the queue and we want to search further
+    if (!detect) {
+        return;
+    }
+
+    quiet::search(node.field, 1, 2, [&] (quiet::Result q) {
+        auto plan_pop = q.plan;
+        plan_pop.pop();
+
+        auto attack = attack::Data {
+            .count = q.chain.count,
+            .score = q.chain.score,
+            .score_total = node.score + q.chain.score,
+            .frame = node.frame + q.plan.get_height(q.x) - node.field.get_height(q.x),
+            .frame_real = node.frame + 1 + q.plan.get_height(q.x) - node.field.get_height(q.x),
+            .all_clear = false,
+            .redundancy = INT32_MAX,
+            .link = eval::get_link(plan_pop)
+        };
+
+        collection.attacks_detect.add(attack, [&] (attack::Data& a) {
+            a.parent = node.field;
+            a.result = plan_pop;
+        });
+    });
+};
+
+Collector::Collector(size_t capacity)
+{
+    this->capacity = capacity;
+};
+
+// Returns the kept attacks
+// In streaming mode, the attacks are sorted from best to worst by cmp_main()
+std::vector<attack::Data> Collector::get()
+{
+    if (this->capacity == 0) {
+        return std::move(this->data);
+    }
+
+    std::vector<attack::Data> result;
+
+    for (auto& slot : this->slots) {
+        if (slot.top || slot.front) {
+            result.push_back(slot.data);
+        }
+    }
+
+    std::sort(
+        result.begin(),
+        result.end(),
+        [] (const attack::Data& a, const attack::Data& b) {
+            return attack::cmp_main(b, a);
+        }
+    );
+
+    return result;
+};
+
+// Adds the attacks kept by another collector
+// In keep-all mode, they are appended after ours in the order they were found
+void Collector::merge(Collector& other)
+{
+    if (this->capacity == 0) {
+        this->data.insert(this->data.end(), other.data.begin(), other.data.end());
+        return;
+    }
+
+    for (auto& slot : other.slots) {
+        if (slot.top || slot.front) {
+            this->add(slot.data, [] (attack::Data& a) {});
         }
     }
 };
 
+// Checks if an attack is among the best attacks found
+bool Collector::is_top(const attack::Data& attack)
+{
+    if (this->top.size() < this->capacity) {
+        return true;
+    }
+
+    return attack::cmp_main(this->slots[this->top.front()].data, attack);
+};
+
+// Returns where an attack would be inserted in the frontier
+// Returns -1 if an attack in the frontier is at least as fast and as strong
+i32 Collector::get_front_position(const attack::Data& attack)
+{
+    auto it = std::upper_bound(
+        this->front.begin(),
+        this->front.end(),
+        attack.frame_real,
+        [&] (i32 frame, i32 index) {
+            return frame < this->slots[index].data.frame_real;
+        }
+    );
+
+    i32 position = i32(it - this->front.begin());
+
+    if (position > 0 && this->slots[this->front[position - 1]].data.score >= attack.score) {
+        return -1;
+    }
+
+    return position;
+};
+
+// Gets an empty slot
+i32 Collector::get_slot()
+{
+    if (!this->slots_free.empty()) {
+        i32 index = this->slots_free.back();
+        this->slots_free.pop_back();
+        return index;
+    }
+
+    this->slots.push_back(Slot());
+
+    return i32(this->slots.size()) - 1;
+};
+
+// Adds an attack to the best attacks, and removes the worst one if there are too many
+void Collector::add_top(i32 index)
+{
+    auto cmp = [&] (i32 a, i32 b) {
+        return attack::cmp_main(this->slots[b].data, this->slots[a].data);
+    };
+
+    this->slots[index].top = true;
+    this->top.push_back(index);
+    std::push_heap(this->top.begin(), this->top.end(), cmp);
+
+    if (this->top.size() > this->capacity) {
+        std::pop_heap(this->top.begin(), this->top.end(), cmp);
+
+        i32 worst = this->top.back();
+        this->top.pop_back();
+
+        this->slots[worst].top = false;
+        this->release(worst);
+    }
+};
+
+// Adds an attack to the frontier and removes the attacks it dominates
+void Collector::add_front(i32 index, i32 position)
+{
+    auto& attack = this->slots[index].data;
+
+    // Slower attacks that aren't stronger
+    i32 end = position;
+
+    while (end < i32(this->front.size()) && this->slots[this->front[end]].data.score <= attack.score) {
+        this->slots[this->front[end]].front = false;
+        this->release(this->front[end]);
+        end += 1;
+    }
+
+    this->front.erase(this->front.begin() + position, this->front.begin() + end);
+
+    // A weaker attack as fast as this one
+    if (position > 0 && this->slots[this->front[position - 1]].data.frame_real == attack.frame_real) {
+        position -= 1;
+
+        this->slots[this->front[position]].front = false;
+        this->release(this->front[position]);
+        this->front.erase(this->front.begin() + position);
+    }
+
+    this->slots[index].front = true;
+    this->front.insert(this->front.begin() + position, index);
+};
+
+// Frees a slot that is neither among the best attacks nor on the frontier
+void Collector::release(i32 index)
+{
+    if (this->slots[index].top || this->slots[index].front) {
+        return;
+    }
+
+    this->slots_free.push_back(index);
+};
+
 };
 
 };
\ No newline at end of file
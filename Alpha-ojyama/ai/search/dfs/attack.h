@@ -1,6 +1,7 @@
 #pragma once
 
 #include "eval.h"
+#include "../../path.h"
 
 namespace dfs
 {
@@ -29,6 +30,52 @@ struct Node
     i32 frame = 0;
 };
 
+// Collects the attacks of 1 category while searching
+// If "capacity" is 0, every attack is kept in the order it was found
+// Otherwise, we only keep the attacks on the Pareto frontier of (score, frame_real) and the "capacity" best attacks by cmp_main()
+// - the frontier is sorted by frame_real with strictly increasing scores, so checking an attack is a binary search
+// - the best attacks are kept in a heap with the worst one on top
+// The fields of an attack are only filled in if the attack is kept
+class Collector
+{
+public:
+    struct Slot
+    {
+        attack::Data data = attack::Data();
+        bool top = false;
+        bool front = false;
+    };
+public:
+    size_t capacity = 0;
+    std::vector<attack::Data> data;
+    std::vector<Slot> slots;
+    std::vector<i32> slots_free;
+    std::vector<i32> top;
+    std::vector<i32> front;
+public:
+    Collector(size_t capacity = 0);
+public:
+    template <typename T>
+    void add(const attack::Data& attack, T&& fill);
+    std::vector<attack::Data> get();
+    void merge(Collector& other);
+public:
+    bool is_top(const attack::Data& attack);
+    i32 get_front_position(const attack::Data& attack);
+    i32 get_slot();
+    void add_top(i32 index);
+    void add_front(i32 index, i32 position);
+    void release(i32 index);
+};
+
+// The collectors of a candidate's attacks while searching
+struct Collection
+{
+    Collector attacks;
+    Collector attacks_ac;
+    Collector attacks_detect;
+};
+
 struct Candidate
 {
     move::Placement placement;
@@ -46,18 +93,43 @@ struct Result
 Result search(
     Field field,
     cell::Queue queue,
+    Pool& pool,
     bool detect = true,
     i32 frame_delay = 0,
-    i32 thread_count = 4
+    size_t keep = 0,
+    bool path = false
 );
 
 void dfs(
     Node& node,
     cell::Queue& queue,
     Candidate& candidate,
+    Collection& collection,
+    i32 depth,
+    bool detect,
+    i32 frame_delay,
+    bool path
+);
+
+std::optional<Node> expand(
+    Node& node,
+    move::Placement placement,
+    cell::Pair pair,
+    Candidate& candidate,
+    Collection& collection,
+    i32 frame_delay,
+    path::Frames* frames
+);
+
+void visit(
+    Node& node,
+    cell::Queue& queue,
+    Candidate& candidate,
+    Collection& collection,
     i32 depth,
     bool detect,
-    i32 frame_delay
+    i32 frame_delay,
+    bool path
 );
 
 inline bool cmp_main(const attack::Data& a, const attack::Data& b)
@@ -85,6 +157,38 @@ inline bool cmp_main_enough(const attack::Data& a, const attack::Data& b, i32 tr
     return a.score < b.score;
 };
 
+// Adds an attack
+// "fill" is called with the kept attack to fill in its fields
+template <typename T>
+inline void Collector::add(const attack::Data& attack, T&& fill)
+{
+    if (this->capacity == 0) {
+        this->data.push_back(attack);
+        fill(this->data.back());
+        return;
+    }
+
+    bool top = this->is_top(attack);
+    i32 front_position = this->get_front_position(attack);
+
+    if (!top && front_position < 0) {
+        return;
+    }
+
+    i32 index = this->get_slot();
+
+    this->slots[index].data = attack;
+    fill(this->slots[index].data);
+
+    if (top) {
+        this->add_top(index);
+    }
+
+    if (front_position >= 0) {
+        this->add_front(index, front_position);
+    }
+};
+
 };
 
 };
\ No newline at end of file
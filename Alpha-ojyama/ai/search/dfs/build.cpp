@@ -1,4 +1,5 @@
 #include "build.h"
+#include "../../../lib/rapidhash/rapidhash.h"
 
 namespace dfs
 {
@@ -7,7 +8,16 @@ namespace build
 {
 
 // Starts the depth first search
-Result search(Field field, cell::Queue queue, eval::Weight w, i32 thread_count)
+// The first 2 placements are split into tasks on the caller's work-stealing pool, so that the threads stay busy even when there are few first placements or their subtrees are unbalanced
+// The tasks are in their own group, so the pool can be shared with other searches running at the same time
+// The results are merged in placement order after the tasks are done, so they don't depend on the threads' timing
+Result search(
+    Field field,
+    cell::Queue queue,
+    eval::Weight w,
+    Pool& pool,
+    Configs configs
+)
 {
     // We don't search if the input queue is too small
     if (queue.size() < 2) {
@@ -26,127 +36,367 @@ Result search(Field field, cell::Queue queue, eval::Weight w, i32 thread_count)
     // Generates all the possible first placements
     auto placements = move::generate(field, queue[0].first == queue[0].second);
 
-    // Divides the works among the threads
+    path::Frames frames;
+
+    if (configs.path) {
+        frames = path::Finder::get_frames(field, queue[0].first == queue[0].second);
+    }
+
+    // The search's states of the first placements
+    struct Branch
+    {
+        Candidate candidate;
+        std::optional<Node> child;
+        avec<move::Placement, 22> placements;
+        path::Frames frames;
+        eval::Result evals[22];
+        std::atomic<bool> stopped = false;
+        std::atomic<i32> remain = 0;
+        std::atomic<bool> complete = false;
+    };
+
+    // Checks if the search was stopped
+    auto is_stopped = [&] () {
+        return configs.stop != nullptr && configs.stop->is_stopped();
+    };
+
+    std::vector<Branch> branches(placements.get_size());
+
+    // Gets a branch's candidate from the evals of its second placements
+    // Returns nothing if the branch leads to a dead end
+    auto get_candidate = [] (Branch& branch) -> std::optional<Candidate> {
+        auto candidate = branch.candidate;
+
+        for (i32 k = 0; k < branch.placements.get_size(); ++k) {
+            build::update(candidate.eval, branch.evals[k]);
+        }
+
+        if (candidate.eval.value == INT32_MIN) {
+            return {};
+        }
+
+        return candidate;
+    };
+
+    // Reports the candidates completed so far
     std::mutex mtx;
-    std::vector<std::thread> threads;
 
-    for (i32 t = 0; t < thread_count; ++t) {
-        threads.emplace_back([&] () {
-            while (true)
-            {
-                move::Placement placement;
+    auto report = [&] () {
+        std::lock_guard<std::mutex> lk(mtx);
 
-                // Locks mutex and takes 1 placements from the placements list above
-                {
-                    std::lock_guard<std::mutex> lk(mtx);
+        auto snapshot = Result();
 
-                    if (placements.get_size() < 1) {
-                        break;
-                    }
+        for (auto& branch : branches) {
+            if (!branch.complete || branch.stopped) {
+                continue;
+            }
 
-                    placement = placements[placements.get_size() - 1];
-                    placements.pop();
-                }
+            if (auto candidate = get_candidate(branch)) {
+                snapshot.candidates.push_back(std::move(*candidate));
+            }
+        }
 
-                // Creates candidate
-                Candidate candidate = Candidate {
-                    .placement = placement,
-                    .eval = eval::Result(),
-                    .eval_fast = INT32_MIN
-                };
+        configs.progress(snapshot);
+    };
 
-                // Updates child node
-                auto child = root;
+    // Gets the transposition table
+    Table* table = nullptr;
 
-                child.field.drop_pair(placement.x, placement.r, queue[0]);
-                auto mask_pop = child.field.pop();
+    if (configs.table) {
+        table = &build::get_table();
+        table->clear();
+    }
 
-                // Death
-                if (child.field.get_height(2) > 11) {
-                    continue;
-                }
+    Pool::Group group;
 
-                // Updates child's stats
-                child.tear += root.field.get_drop_pair_frame(placement.x, placement.r) - 1;
-                child.waste += mask_pop.get_size();
+    for (i32 i = 0; i < placements.get_size(); ++i) {
+        pool.submit([&, i] () {
+            auto& branch = branches[i];
 
-                candidate.eval_fast = eval::evaluate(child.field, child.tear, child.waste, w).value;
+            if (is_stopped()) {
+                branch.stopped = true;
+                return;
+            }
 
-                // Continues searching to evaluate
-                candidate.eval = build::dfs(child, queue, w, 1);
+            // Creates candidate
+            branch.candidate = Candidate {
+                .placement = placements[i],
+                .eval = eval::Result(),
+                .eval_fast = INT32_MIN
+            };
 
-                // This child leads to a dead end, so we prune it
-                if (candidate.eval.value == INT32_MIN) {
-                    continue;
-                }
+            // Creates child node
+            branch.child = build::get_child(root, placements[i], queue[0], configs.path ? &frames : nullptr);
 
-                // Locks mutex and pushes the candidate
-                {
-                    std::lock_guard<std::mutex> lk(mtx);
-                    result.candidates.push_back(std::move(candidate));
-                }
+            if (!branch.child) {
+                return;
             }
-        });
+
+            branch.candidate.eval_fast = eval::evaluate(branch.child->field, branch.child->tear, branch.child->waste, w).value;
+
+            // Splits the search of every second placement into its own task
+            branch.placements = move::generate(branch.child->field, queue[1].first == queue[1].second);
+
+            if (configs.path) {
+                branch.frames = path::Finder::get_frames(branch.child->field, queue[1].first == queue[1].second);
+            }
+
+            branch.remain = branch.placements.get_size();
+
+            for (i32 k = 0; k < branch.placements.get_size(); ++k) {
+                pool.submit([&, i, k] () {
+                    auto& branch = branches[i];
+
+                    if (is_stopped()) {
+                        branch.stopped = true;
+                    }
+                    else if (auto grandchild = build::get_child(*branch.child, branch.placements[k], queue[1], configs.path ? &branch.frames : nullptr)) {
+                        branch.evals[k] = build::get_eval(*grandchild, queue, w, 2, table, configs);
+                    }
+
+                    // The candidate is complete once all its second placements are searched
+                    if (--branch.remain == 0 && configs.progress) {
+                        branch.complete = true;
+                        report();
+                    }
+                }, &group);
+            }
+        }, &group);
     }
 
-    // Joins threads
-    for (auto& t : threads) {
-        t.join();
+    pool.wait(group);
+
+    // Merges the results
+    for (auto& branch : branches) {
+        if (!branch.child || branch.stopped) {
+            continue;
+        }
+
+        // This child leads to a dead end, so we prune it
+        if (auto candidate = get_candidate(branch)) {
+            result.candidates.push_back(std::move(*candidate));
+        }
     }
 
     return result;
 };
 
 // Depth first search
-eval::Result dfs(Node& node, cell::Queue& queue, eval::Weight& w, i32 depth)
+eval::Result dfs(Node& node, cell::Queue& queue, eval::Weight& w, i32 depth, Table* table, const Configs& configs)
 {
     auto result = eval::Result();
 
     // Generates possible placements
     auto placements = move::generate(node.field, queue[depth].first == queue[depth].second);
 
+    path::Frames frames;
+
+    if (configs.path) {
+        frames = path::Finder::get_frames(node.field, queue[depth].first == queue[depth].second);
+    }
+
+    if (!configs.cutoff) {
+        for (i32 i = 0; i < placements.get_size(); ++i) {
+            // Creates child node
+            auto child = build::get_child(node, placements[i], queue[depth], configs.path ? &frames : nullptr);
+
+            if (!child) {
+                continue;
+            }
+
+            // Evaluates and updates the best eval
+            build::update(result, build::get_eval(*child, queue, w, depth + 1, table, configs));
+        }
+
+        return result;
+    }
+
+    // Orders the children by their fast eval
+    avec<std::pair<i32, Node>, 22> children;
+
     for (i32 i = 0; i < placements.get_size(); ++i) {
-        // Creates child node
-        auto child = node;
-        child.field.drop_pair(placements[i].x, placements[i].r, queue[depth]);
-        auto mask_pop = child.field.pop();
+        auto child = build::get_child(node, placements[i], queue[depth], configs.path ? &frames : nullptr);
 
-        // Checks for death
-        if (child.field.get_height(2) > 11) {
+        if (!child) {
             continue;
         }
 
-        // Updates stats
-        child.tear += node.field.get_drop_pair_frame(placements[i].x, placements[i].r) - 1;
-        child.waste += mask_pop.get_size();
-
-        // Evaluates
-        eval::Result eval = eval::Result();
+        children.add({ eval::evaluate_fast(child->field, child->tear, child->waste, w), *child });
+    }
 
-        if (depth + 1 < queue.size()) {
-            // Continues search if we aren't at the end of the queue
-            eval = build::dfs(child, queue, w, depth + 1);
+    std::stable_sort(
+        children.iter_begin(),
+        children.iter_end(),
+        [] (const std::pair<i32, Node>& a, const std::pair<i32, Node>& b) {
+            return a.first > b.first;
         }
-        else {
-            // Evaluates if we are at the end of the queue
-            eval = eval::evaluate(child.field, child.tear, child.waste, w);
+    );
+
+    for (i32 i = 0; i < children.get_size(); ++i) {
+        // The remaining children are even worse
+        if (result.value != INT32_MIN && i64(children[i].first) + configs.margin < result.value) {
+            break;
         }
 
-        // Updates the best eval score
-        if (eval.value > result.value) {
-            result.value = eval.value;
-            result.plan = eval.plan;
+        build::update(result, build::get_eval(children[i].second, queue, w, depth + 1, table, configs));
+    }
+
+    return result;
+};
+
+// Places a pair on a node's field and updates the stats
+// If "frames" is set, the placement's input frames are added to the tear term
+// Returns nothing if we die
+std::optional<Node> get_child(Node& node, move::Placement placement, cell::Pair pair, path::Frames* frames)
+{
+    auto child = node;
+    child.field.drop_pair(placement.x, placement.r, pair);
+    auto mask_pop = child.field.pop();
+
+    // Checks for death
+    if (child.field.get_height(2) > 11) {
+        return {};
+    }
+
+    // Updates stats
+    child.tear += node.field.get_drop_pair_frame(placement.x, placement.r) - 1;
+
+    if (frames != nullptr) {
+        child.tear += frames->get(placement) - 1;
+    }
+    child.waste += mask_pop.get_size();
+
+    return child;
+};
+
+// Evaluates a node at this depth
+eval::Result get_eval(Node& node, cell::Queue& queue, eval::Weight& w, i32 depth, Table* table, const Configs& configs)
+{
+    // The tear and waste terms of this node's eval
+    i32 offset = node.tear * w.tear + node.waste * w.waste;
+
+    u64 hash = 0;
+    auto result = eval::Result();
+
+    // Checks the transposition table
+    if (table != nullptr) {
+        hash = Table::get_hash(node.field);
+
+        if (table->get(hash, depth, result)) {
+            if (result.value != INT32_MIN) {
+                result.value += offset;
+            }
+
+            return result;
         }
+    }
+
+    if (depth < queue.size()) {
+        // Continues search if we aren't at the end of the queue
+        result = build::dfs(node, queue, w, depth, table, configs);
+    }
+    else {
+        // Evaluates if we are at the end of the queue
+        result = eval::evaluate(node.field, node.tear, node.waste, w);
+    }
+
+    // Saves the eval without this node's tear and waste terms
+    if (table != nullptr) {
+        auto entry = result;
 
-        // Updates the highest possible chain score from this field
-        if (eval.q > result.q) {
-            result.q = eval.q;
+        if (entry.value != INT32_MIN) {
+            entry.value -= offset;
         }
+
+        table->set(hash, depth, entry);
     }
 
     return result;
 };
 
+// Updates the best eval of a node with a child's eval
+void update(eval::Result& result, const eval::Result& eval)
+{
+    // Updates the best eval score
+    if (eval.value > result.value) {
+        result.value = eval.value;
+        result.plan = eval.plan;
+    }
+
+    // Updates the highest possible chain score from this field
+    if (eval.q > result.q) {
+        result.q = eval.q;
+    }
+};
+
+Table::Table()
+{
+    this->data.resize(SIZE);
+};
+
+// Starts a new search
+void Table::clear()
+{
+    this->age += 1;
+
+    // Resets the table when the age wraps around
+    if (this->age == 0) {
+        for (auto& entry : this->data) {
+            entry = Entry();
+        }
+
+        this->age = 1;
+    }
+};
+
+// Gets the eval of a node
+// Returns false if the node isn't in the table
+bool Table::get(u64 hash, i32 depth, eval::Result& eval)
+{
+    size_t index = hash & (SIZE - 1);
+
+    std::lock_guard<std::mutex> lk(this->locks[index % LOCK_COUNT]);
+
+    auto& entry = this->data[index];
+
+    if (entry.age != this->age || entry.hash != hash || entry.depth != depth) {
+        return false;
+    }
+
+    eval = entry.eval;
+
+    return true;
+};
+
+// Saves the eval of a node, replacing the old entry
+void Table::set(u64 hash, i32 depth, const eval::Result& eval)
+{
+    size_t index = hash & (SIZE - 1);
+
+    std::lock_guard<std::mutex> lk(this->locks[index % LOCK_COUNT]);
+
+    this->data[index] = Entry {
+        .hash = hash,
+        .depth = depth,
+        .age = this->age,
+        .eval = eval
+    };
+};
+
+// Every thread calling search() has its own table, which is shared with the threads of its searches
+// The searches running at the same time, like the ones of search::Thread, are called from different threads, so they don't share a table
+Table& get_table()
+{
+    thread_local Table table;
+    return table;
+};
+
+// Hashes a field, including its 14th row
+u64 Table::get_hash(Field& field)
+{
+    return rapidhash_withSeed((const void*)field.data, sizeof(field.data), u64(field.row14) + 1);
+};
+
 };
 
 };
\ No newline at end of file
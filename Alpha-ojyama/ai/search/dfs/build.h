@@ -1,6 +1,7 @@
 #pragma once
 
 #include "eval.h"
+#include "../../path.h"
 
 namespace dfs
 {
@@ -27,9 +28,73 @@ struct Result
     std::vector<Candidate> candidates;
 };
 
-Result search(Field field, cell::Queue queue, eval::Weight w, i32 thread_count = 4);
+typedef std::function<void(const Result&)> Progress;
 
-eval::Result dfs(Node& node, cell::Queue& queue, eval::Weight& w, i32 depth);
+// Search options
+// - table: caches the evals of the nodes reached by different placement orders
+// - cutoff: searches the children from the best to the worst by their fast eval, and skips the children whose fast eval plus "margin" can't beat the best eval found
+//   The fast eval isn't a real bound of the children's evals, so this is a heuristic that may miss the best placement
+// - stop: stops the search early, only the candidates that were searched completely are returned
+// - path: the tear term also counts the real input frames of the placements, see path::Finder::get_frames()
+// - progress: called with the candidates searched completely so far, each time a candidate is completed
+struct Configs
+{
+    bool table = true;
+    bool cutoff = false;
+    i32 margin = 0;
+    Stop* stop = nullptr;
+    bool path = false;
+    Progress progress = nullptr;
+};
+
+// The transposition table shared by the threads of 1 search
+// The evals are keyed by (field, depth), since the queue is the same for all the nodes at the same depth
+// The values are stored without the tear and waste terms, because they are the only terms that depend on the path to the node
+// Entries are tagged with the search's age, so the table is reused by the next search without clearing it, see get_table()
+class Table
+{
+public:
+    static constexpr size_t SIZE = 1 << 15;
+    static constexpr size_t LOCK_COUNT = 64;
+public:
+    struct Entry
+    {
+        u64 hash = 0;
+        i32 depth = -1;
+        u32 age = 0;
+        eval::Result eval = eval::Result();
+    };
+public:
+    std::vector<Entry> data;
+    std::mutex locks[LOCK_COUNT];
+    u32 age = 0;
+public:
+    Table();
+public:
+    void clear();
+    bool get(u64 hash, i32 depth, eval::Result& eval);
+    void set(u64 hash, i32 depth, const eval::Result& eval);
+public:
+    static u64 get_hash(Field& field);
+};
+
+Table& get_table();
+
+Result search(
+    Field field,
+    cell::Queue queue,
+    eval::Weight w,
+    Pool& pool,
+    Configs configs = Configs()
+);
+
+eval::Result dfs(Node& node, cell::Queue& queue, eval::Weight& w, i32 depth, Table* table, const Configs& configs);
+
+std::optional<Node> get_child(Node& node, move::Placement placement, cell::Pair pair, path::Frames* frames);
+
+eval::Result get_eval(Node& node, cell::Queue& queue, eval::Weight& w, i32 depth, Table* table, const Configs& configs);
+
+void update(eval::Result& result, const eval::Result& eval);
 
 };
 
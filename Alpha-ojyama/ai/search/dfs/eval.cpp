@@ -60,6 +60,21 @@ Result evaluate(Field& field, i32 tear, i32 waste, const Weight& w)
         eval += q;
     }
 
+    // Evaluation value without the quiescence search
+    eval += eval::evaluate_fast(field, tear, waste, w);
+
+    return Result {
+        .value = eval,
+        .q = q_max,
+        .plan = plan
+    };
+};
+
+// Evaluates a field without the quiescence search
+i32 evaluate_fast(Field& field, i32 tear, i32 waste, const Weight& w)
+{
+    i32 eval = 0;
+
     // Static evaluation value
     eval += eval::get_static(field, w);
 
@@ -84,11 +99,7 @@ Result evaluate(Field& field, i32 tear, i32 waste, const Weight& w)
     // Avoids wasting resource by popping puyos
     eval += waste * w.waste;
 
-    return Result {
-        .value = eval,
-        .q = q_max,
-        .plan = plan
-    };
+    return eval;
 };
 
 // Returns static eval
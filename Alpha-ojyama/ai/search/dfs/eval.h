@@ -49,6 +49,8 @@ constexpr Weight DEFAULT = {
 
 Result evaluate(Field& field, i32 tear, i32 waste, const Weight& w);
 
+i32 evaluate_fast(Field& field, i32 tear, i32 waste, const Weight& w);
+
 i32 get_static(Field& field, const Weight& w);
 
 i32 get_chi(u8 heights[6], i8 x);
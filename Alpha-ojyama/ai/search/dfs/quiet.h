@@ -16,34 +16,419 @@ struct Result
     Field remain = Field();
 };
 
-void search(
+constexpr i32 DEPTH_MAX = 16;
+
+struct Move
+{
+    i8 x;
+    i8 p;
+    i8 need;
+    i8 dir;
+};
+
+// Transposition table for quiet::search()
+// Different extension orders often reach the same plan
+// Keeps the highest remaining depth every plan was searched with, so that we don't search the same plan twice
+// Entries are tagged with the search's age, so clearing the table is free
+class Table
+{
+public:
+    static constexpr size_t SIZE = 1 << 12;
+public:
+    struct Entry
+    {
+        u64 hash = 0;
+        i32 depth = 0;
+        u32 age = 0;
+    };
+public:
+    Entry data[SIZE];
+    u32 age = 0;
+public:
+    void clear();
+    bool visit(u64 hash, i32 depth);
+};
+
+Table& get_table();
+
+u64 get_hash(Field& plan, i8 x_ban);
+
+std::pair<i8, i8> get_bound(u8 heights[6]);
+
+bool is_reachable(u8 heights[6], i8 x);
+
+// Finds dropping positions that may trigger a chain
+// The callback is called with (x, color, key puyos needed, direction) for every trigger found
+template <typename T>
+inline void generate(
     Field& field,
-    i32 depth,
+    i8 x_min,
+    i8 x_max,
+    i8 x_ban,
     i32 drop,
-    std::function<void(Result)> callback
-);
+    T&& callback
+)
+{
+    u8 heights[6];
+    field.get_heights(heights);
+
+    // Map for checking transpositions while dropping pairs horizontally
+    //
+    // Ex:
+    // 1. We can drop 1 green on the 1st column then drop another green on the 2nd column
+    // ......    ......    ......
+    // ...... -> G..... -> GG....
+    // GG....    GG....    GG....
+    //
+    // 2. We can also drop 1 green on the 2nd column then drop another on the 1st column to reach the same result
+    // ......    ......    ......
+    // ...... -> .G.... -> GG....
+    // GG....    GG....    GG....
+    //
+    // Even though we only drop 1 green-green pair on the 1st and 2nd columns, we have to call the callback() function twice
+    // Using this map, we can check for duplicates and remove them
+    bool horizontal_checked[5][cell::COUNT - 1] = { false };
 
-void dfs(
+    u8 need[6][cell::COUNT - 1];
+    field.get_key_need(drop, need);
+
+    for (i8 x = x_min; x <= x_max; ++x) {
+        if (x == x_ban) {
+            continue;
+        }
+
+        // Checks if we can drop puyos horizontally left and right
+        // We can only extend the chain horizontally if the surface is flat
+        //
+        // Ex:
+        // 1. We can extend this chain horizontally because the 3rd and 4th columns have the same heights:
+        // ......    ......
+        // ......    ......
+        // .R.... -> .RBB..
+        // .BB#..    .BB#..
+        // RRR#..    RRR#..
+        //
+        // 2. We can't extend this chain horizontally because the 3rd and 4th columns have different heights
+        //    We are forced to drop puyos vertically on the 3rd column:
+        // ......    ......
+        // ......    ..B...
+        // .R.... -> .RB...
+        // .BB...    .BB...
+        // RRR...    RRR...
+        bool expand_r = (x < 5) && (x + 1 != x_ban) && (heights[x] == heights[x + 1]) && !(x == 1 && heights[2] == 11);
+        bool expand_l = (x > 0) && (x - 1 != x_ban) && (heights[x] == heights[x - 1]) && !(x == 3 && heights[2] == 11);
+
+        // Finds the maximum amount of puyo blobs that can be drop
+        i32 drop_max = std::min(drop, 12 - i32(heights[x]));
+
+        if (drop_max <= 0) {
+            continue;
+        }
+
+        // For every color
+        for (u8 p = 0; p < cell::COUNT - 1; ++p) {
+            if (need[x][p] == 0) {
+                continue;
+            }
+
+            callback(x, p, need[x][p], 0);
+
+            // Tries dropping horizontally
+            if (need[x][p] > 1) {
+                // Extends right
+                if (expand_r && !horizontal_checked[x][p]) {
+                    callback(x, p, drop_max, 1);
+                    horizontal_checked[x][p] = true;
+                }
+
+                // Extends left
+                if (expand_l && !horizontal_checked[x - 1][p]) {
+                    callback(x, p, drop_max, -1);
+                    horizontal_checked[x - 1][p] = true;
+                }
+            }
+        }
+    }
+};
+
+// Continues dropping puyos to extend chains
+// Searches with an explicit stack, in the same order as a recursive search would
+template <typename T>
+inline void dfs(
     Field& field,
     Field& root,
     i8 x_ban,
     i32 pre_chain,
     i32 depth,
-    std::function<void(Result)>& callback
-);
+    Table& table,
+    i32& budget,
+    T& callback
+)
+{
+    struct Frame
+    {
+        Field field;
+        Field root;
+        u8 root_heights[6];
+        i32 pre_chain;
+        i32 depth;
+        avec<Move, 6 * (cell::COUNT - 1) * 3> moves;
+        i32 index;
+    };
 
-std::pair<i8, i8> get_bound(u8 heights[6]);
+    avec<Frame, DEPTH_MAX> stack;
 
-bool is_reachable(u8 heights[6], i8 x);
+    // Generates the moves of a frame
+    auto push = [&] (Field& field, Field& root, i32 pre_chain, i32 depth) {
+        stack.add(Frame());
+
+        auto& frame = stack[stack.get_size() - 1];
+
+        frame.field = field;
+        frame.root = root;
+        frame.root.get_heights(frame.root_heights);
+        frame.pre_chain = pre_chain;
+        frame.depth = depth;
+        frame.index = 0;
+
+        auto [x_min, x_max] = quiet::get_bound(frame.root_heights);
+
+        quiet::generate(
+            frame.field,
+            x_min,
+            x_max,
+            x_ban,
+            2,
+            [&] (i8 x, i8 p, i8 need, i8 dir) {
+                frame.moves.add(Move { x, p, need, dir });
+            }
+        );
+    };
+
+    push(field, root, pre_chain, std::min(depth, DEPTH_MAX));
+
+    while (stack.get_size() > 0) {
+        auto& frame = stack[stack.get_size() - 1];
 
-void generate(
+        if (frame.index >= frame.moves.get_size()) {
+            stack.pop();
+            continue;
+        }
+
+        auto [x, p, need, dir] = frame.moves[frame.index];
+        frame.index += 1;
+
+        u8* root_heights = frame.root_heights;
+
+        // Checks if we dropped the key puyos above the 12th row or killed ourself
+        if (i32(root_heights[x]) + need + (x == 2) > 12) {
+            continue;
+        }
+
+        // Drops puyos
+        auto plan = frame.root;
+
+        switch (dir)
+        {
+        case 0:
+            // Dropping vertically
+            for (i32 i = 0; i < need; ++i) {
+                plan.data[p].set_bit(x, root_heights[x] + i);
+            }
+            break;
+        case 1:
+            // Expanding to the right
+            plan.data[p].set_bit(x, root_heights[x]);
+            plan.data[p].set_bit(x + 1, root_heights[x + 1]);
+            break;
+        case -1:
+            // Expanding to the left
+            plan.data[p].set_bit(x, root_heights[x]);
+            plan.data[p].set_bit(x - 1, root_heights[x - 1]);
+            break;
+        }
+
+        // Checks for chain cuts
+        if (plan.data[p].get_mask_group_4(x, root_heights[x]).get_count() > 3) {
+            continue;
+        }
+
+        // Checks if we can reach the trigger point after dropping the key puyos
+        //
+        // Ex:
+        // ....Y.    ...BY.  (12th row)
+        // .BBYY. -> .BBYY.
+        // ###BY#    ###BY#
+        // ######    ######
+        //
+        // We can place a blue puyo on the 4th column to extend this chain
+        // However, realistically, to trigger the chain, we first have to place the blue puyo first, then the yellow puyo last
+        // But dropping the blue puyo on the 4th column blocks the way for the yellow puyo to reach the 5th column
+        // So this chain is actually impossible and we have to prune this
+        //
+        // Notes:
+        // In reality, sometimes we CAN reach the 5th column even if we drop the blue puyo on the 4th column
+        // However, since quiet::search() is only an estimation for the field's potential chain, we want to eliminate as much risk as possible
+        u8 plan_heights[6];
+        plan.get_heights(plan_heights);
+
+        if (!quiet::is_reachable(plan_heights, x_ban)) {
+            continue;
+        }
+
+        // Stops if we ran out of nodes
+        if (budget <= 0) {
+            return;
+        }
+
+        budget -= 1;
+
+        // Simulates chain
+        auto sim = plan;
+        auto sim_mask = sim.pop();
+
+        // If we extended the chain successfully
+        if (sim_mask.get_size() <= frame.pre_chain) {
+            continue;
+        }
+
+        // Checks for transpositions
+        // Everything found from here on only depends on the plan, so we skip it if we already searched this plan as deep
+        if (!table.visit(quiet::get_hash(plan, x_ban), frame.depth - 1)) {
+            continue;
+        }
+
+        // Callback
+        callback(Result {
+            .chain = chain::get_score(sim_mask),
+            .x = x_ban,
+            .plan = plan,
+            .remain = sim
+        });
+
+        // Continues searching
+        if (frame.depth > 1) {
+            push(sim, plan, sim_mask.get_size(), frame.depth - 1);
+        }
+    }
+};
+
+// Searches all the potential chain extensions of the field
+// This function behaves like quiescence search in chess engines
+// We continue dropping key puyos until there aren't any possible chains left, then accumulate the results to find the potential chains of the field
+// The callback is called with a Result for every potential chain found
+// The search stops extending chains after simulating "budget" plans
+template <typename T>
+inline void search(
     Field& field,
-    i8 x_min,
-    i8 x_max,
-    i8 x_ban,
+    i32 depth,
     i32 drop,
-    std::function<void(i8, i8, i8, i8)> callback
-);
+    T&& callback,
+    i32 budget = INT32_MAX
+)
+{
+    u8 heights[6];
+    field.get_heights(heights);
+
+    auto& table = quiet::get_table();
+    table.clear();
+
+    auto [x_min, x_max] = quiet::get_bound(heights);
+
+    // Drops puyo until a chain is triggered for all columns and colors
+    quiet::generate(
+        field,
+        x_min,
+        x_max,
+        -1,
+        drop,
+        [&] (i8 x, i8 p, i8 need, i8 dir) {
+            // We don't drop puyos horizontally on the 1st time
+            if (dir != 0) {
+                return;
+            }
+
+            // Drops puyo
+            auto plan = field;
+
+            for (i32 i = 0; i < need; ++i) {
+                plan.data[p].set_bit(x, heights[x] + i);
+            }
+
+            // Pops field
+            auto sim = plan;
+            auto sim_mask = sim.pop();
+            auto sim_chain = chain::get_score(sim_mask);
+
+            // Checks for callback
+            if (sim_chain.count > 1) {
+                callback(Result {
+                    .chain = chain::Score {
+                        .count = sim_chain.count,
+                        .score = sim_chain.score
+                    },
+                    .x = x,
+                    .plan = plan,
+                    .remain = sim
+                });
+            }
+
+            if (depth < 2) {
+                return;
+            }
+
+            // Checks if this chain is extendable
+            // A chain is extendable if it affects other columns outside the column that we dropped the key puyos
+            //
+            // Ex:
+            // 1. If we drop a blue puyo on the 2nd column, we will change the heights of the 1st columns
+            //    We can then drop a red puyo on the 1st column to extend the chain:
+            // ......    R.....
+            // B.....    B.....
+            // B..... -> B.....
+            // B.....    BB....
+            // RRR...    RRR...
+            //
+            // 2. If we drop a blue puyo on the 1st column, we won't change the heights of any other columns, thus we can't extend this chain:
+            // ......    B.....
+            // B.....    B.....
+            // B..... -> B.....
+            // B.....    B.....
+            // RRR...    RRR...
+            u8 sim_heights[6];
+            sim.get_heights(sim_heights);
+
+            bool extendable = false;
+
+            for (i32 i = x_min; i <= x_max; ++i) {
+                if (i == x) {
+                    continue;
+                }
+
+                if (heights[i] != sim_heights[i]) {
+                    extendable = true;
+                    break;
+                }
+            }
+
+            if (!extendable) {
+                return;
+            }
+
+            // Continues searching
+            quiet::dfs(
+                sim,
+                plan,
+                x,
+                sim_chain.count,
+                depth - 1,
+                table,
+                budget,
+                callback
+            );
+        }
+    );
+};
 
 };
 
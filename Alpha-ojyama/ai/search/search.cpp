@@ -3,65 +3,406 @@
 namespace search
 {
 
-Thread::Thread()
+// The searches and their tasks share 1 long-lived pool, with a thread per hardware thread, at least 1 per search
+// The callers only wait for their job's searches, see wait()
+// Loads the path finder's table for the fast search before any search starts
+Thread::Thread() : pool(std::max(i32(std::thread::hardware_concurrency()), i32(COUNT)) + 1)
 {
-    this->thread = nullptr;
-    this->results = {};
+    path::get_table();
+
+    this->current = &this->job;
+    this->ponder_thread = nullptr;
+    this->ponder_cancelled = false;
+    this->ponder_keep = -1;
 };
 
-// Starts the search thread
+Thread::~Thread()
+{
+    this->cancel();
+    this->cancel_ponder();
+};
+
+// Starts the searches
 // We search all the configuration weights provided
-bool Thread::search(Field field, cell::Queue queue, Configs configs)
+// Returns false if the previous searches haven't been collected with get() or cancelled
+// Stops pondering, since its results won't be used
+bool Thread::search(Field field, cell::Queue queue, Configs configs, Deadlines deadlines)
+{
+    {
+        std::lock_guard<std::mutex> lk(this->mtx);
+
+        if (this->current->results.has_value()) {
+            return false;
+        }
+    }
+
+    this->cancel_ponder();
+
+    this->start(this->job, field, queue, configs, deadlines);
+
+    return true;
+};
+
+// Waits for all the searches and returns their results
+// Pondering doesn't delay this, we only wait for the current job
+std::optional<Result> Thread::get()
 {
-    if (this->thread != nullptr) {
+    auto& job = *this->current;
+
+    this->wait(job);
+
+    std::lock_guard<std::mutex> lk(this->mtx);
+
+    auto result = job.results;
+
+    job.results = {};
+
+    this->current = &this->job;
+    this->cv.notify_all();
+
+    return result;
+};
+
+// Returns a snapshot of the best candidates found so far without waiting
+std::optional<Result> Thread::poll()
+{
+    std::lock_guard<std::mutex> lk(this->mtx);
+
+    return this->current->results;
+};
+
+// Checks if all the searches are finished
+bool Thread::is_done()
+{
+    std::lock_guard<std::mutex> lk(this->mtx);
+
+    return this->current->results.has_value() && this->current->results->is_done();
+};
+
+// Aborts the searches and discards their results
+void Thread::cancel()
+{
+    auto& job = *this->current;
+
+    for (auto& stop : job.stops) {
+        stop.cancel();
+    }
+
+    this->wait(job);
+
+    std::lock_guard<std::mutex> lk(this->mtx);
+
+    job.results = {};
+
+    this->current = &this->job;
+    this->cv.notify_all();
+};
+
+// Starts pondering
+// "queue" is the known queue after the committed placement, the guessed pair is added at its end
+// "budget" is the total time in milliseconds for all the guesses
+// "seen" is the count of each color already dealt from the current bag, see get_guesses()
+// Returns false if we are already searching or pondering
+bool Thread::ponder(Field field, cell::Queue queue, Configs configs, i32 budget, const i32 seen[4])
+{
+    {
+        std::lock_guard<std::mutex> lk(this->mtx);
+
+        if (this->current->results.has_value()) {
+            return false;
+        }
+    }
+
+    // A ponder thread stopped by get_ponder() is only finishing the guess that was already collected
+    if (this->ponder_thread != nullptr && !this->ponder_cancelled) {
         return false;
     }
 
-    this->clear();
+    this->cancel_ponder();
+
+    this->guesses = search::get_guesses(seen);
+    this->ponder_cancelled = false;
+    this->ponder_keep = -1;
+
+    // Shares the budget among the plausible guesses
+    double total = 0.0;
+
+    for (auto& guess : this->guesses) {
+        total += guess.chance;
+    }
+
+    this->ponder_thread = new std::thread([=, this] () {
+        for (size_t i = 0; i < this->guesses.size(); ++i) {
+            auto q = queue;
+            q.push_back(this->guesses[i].pair);
+
+            i32 ms = std::max(i32(double(budget) * this->guesses[i].chance / total), 1);
 
-    this->thread = new std::thread([&] (Field f, cell::Queue q, Configs w) {
-        auto r = Result();
+            // Checks for cancellation under the lock, so that get_ponder() sees whether this guess was started
+            {
+                std::lock_guard<std::mutex> lk(this->mtx);
 
-        r.build = beam::search_multi(f, q, w.build);
-        r.freestyle = dfs::build::search(f, q, w.freestyle);
-        r.fast = dfs::build::search(f, q, w.fast);
-        r.ac = dfs::build::search(f, q, w.ac);
+                if (this->ponder_cancelled) {
+                    break;
+                }
 
-        this->results = r;
-    }, field, queue, configs);
+                this->ponders[i].results = Result();
+            }
+
+            this->start(this->ponders[i], field, q, configs, Deadlines { .build = ms, .freestyle = ms, .fast = ms, .ac = ms });
+
+            // If pondering was stopped while we were starting, this guess may have missed the cancellation
+            if (this->ponder_cancelled && this->ponder_keep != i32(i)) {
+                for (auto& stop : this->ponders[i].stops) {
+                    stop.cancel();
+                }
+            }
+
+            this->wait(this->ponders[i]);
+        }
+    });
 
     return true;
 };
 
-std::optional<Result> Thread::get()
+// Returns the pondered results of the revealed pair and stops pondering
+// The pair's colors order is ignored
+// If the pair is still being searched, we return its snapshot right away and its searches keep running as the current job, see get() and poll()
+// Returns nothing if the pair wasn't pondered
+std::optional<Result> Thread::get_ponder(cell::Pair pair)
 {
-    if (this->thread == nullptr) {
+    if (this->ponder_thread == nullptr || this->ponder_cancelled) {
         return {};
     }
 
-    if (this->thread->joinable()) {
-        this->thread->join();
-    };
+    i32 keep = -1;
+
+    for (size_t i = 0; i < this->guesses.size(); ++i) {
+        auto guess = this->guesses[i].pair;
 
-    auto result = this->results;
+        if (guess == pair || guess == cell::Pair { pair.second, pair.first }) {
+            keep = i32(i);
+            break;
+        }
+    }
 
-    this->clear();
+    std::optional<Result> result = {};
+
+    {
+        std::lock_guard<std::mutex> lk(this->mtx);
+
+        this->ponder_keep = keep;
+        this->ponder_cancelled = true;
+
+        if (keep >= 0 && this->ponders[keep].results.has_value()) {
+            result = this->ponders[keep].results;
+
+            if (!result->is_done()) {
+                this->current = &this->ponders[keep];
+            }
+        }
+    }
+
+    this->stop_ponder();
 
     return result;
 };
 
-void Thread::clear()
+// Stops pondering and discards its results
+void Thread::cancel_ponder()
+{
+    this->ponder_cancelled = true;
+
+    this->stop_ponder();
+};
+
+// Starts the searches of a job
+// The searches publish their best candidates into the job's snapshot while they run
+void Thread::start(Job& job, Field field, cell::Queue queue, Configs configs, Deadlines deadlines)
 {
-    if (this->thread != nullptr) {
-        if (this->thread->joinable()) {
-            this->thread->join();
+    {
+        std::lock_guard<std::mutex> lk(this->mtx);
+
+        job.results = Result();
+    }
+
+    job.stops[BUILD].reset(deadlines.build);
+    job.stops[FREESTYLE].reset(deadlines.freestyle);
+    job.stops[FAST].reset(deadlines.fast);
+    job.stops[AC].reset(deadlines.ac);
+
+    // Saves a search's result into the snapshot and wakes up the callers waiting for this job
+    auto set = [this, &job] (Type type, auto&& callback) {
+        std::lock_guard<std::mutex> lk(this->mtx);
+
+        callback(*job.results);
+        job.results->done[type] = true;
+
+        this->cv.notify_all();
+    };
+
+    // Saves a search's best candidates so far into the snapshot
+    auto publish = [this, &job] (Type type, auto&& callback) {
+        std::lock_guard<std::mutex> lk(this->mtx);
+
+        if (job.results.has_value() && !job.results->done[type]) {
+            callback(*job.results);
         }
+    };
+
+    // Gets the snapshot's field of a dfs search
+    auto get_dfs = [] (Result& result, Type type) -> dfs::build::Result& {
+        switch (type)
+        {
+        case FAST:
+            return result.fast;
+        case AC:
+            return result.ac;
+        default:
+            return result.freestyle;
+        }
+    };
+
+    this->pool.submit([=, this, &job] () {
+        auto c = beam::Configs();
+        c.stop = &job.stops[BUILD];
+        c.plan = configs.plan;
+        c.progress = [=] (const beam::Result& r) {
+            publish(BUILD, [&] (Result& result) { result.build = r; });
+        };
+
+        auto r = beam::search_multi(field, queue, configs.build, c);
 
-        delete this->thread;
+        set(BUILD, [&] (Result& result) { result.build = std::move(r); });
+    });
+
+    auto submit_dfs = [&] (Type type, dfs::eval::Weight w) {
+        this->pool.submit([=, this, &job] () {
+            auto c = dfs::build::Configs();
+            c.stop = &job.stops[type];
+            c.progress = [=] (const dfs::build::Result& r) {
+                publish(type, [&] (Result& result) { get_dfs(result, type) = r; });
+            };
+
+            // The fast mode can minimize the real input time of its placements
+            c.path = configs.path && type == FAST;
+
+            auto r = dfs::build::search(field, queue, w, this->pool, c);
+
+            set(type, [&] (Result& result) { get_dfs(result, type) = std::move(r); });
+        });
+    };
+
+    submit_dfs(FREESTYLE, configs.freestyle);
+    submit_dfs(FAST, configs.fast);
+    submit_dfs(AC, configs.ac);
+};
+
+// Waits until all the searches of a job are finished or their results are collected
+void Thread::wait(Job& job)
+{
+    std::unique_lock<std::mutex> lk(this->mtx);
+
+    this->cv.wait(lk, [&] { return !job.results.has_value() || job.results->is_done(); });
+};
+
+// Stops the guesses, except for the current job if get_ponder() kept it running
+// The ponder thread is joined once the kept guess is collected, since it waits for its searches
+void Thread::stop_ponder()
+{
+    if (this->ponder_thread == nullptr) {
+        return;
     }
 
-    this->thread = nullptr;
-    this->results = {};
+    for (auto& ponder : this->ponders) {
+        if (&ponder == this->current) {
+            continue;
+        }
+
+        for (auto& stop : ponder.stops) {
+            stop.cancel();
+        }
+    }
+
+    if (this->current != &this->job) {
+        return;
+    }
+
+    this->ponder_thread->join();
+
+    delete this->ponder_thread;
+    this->ponder_thread = nullptr;
+
+    std::lock_guard<std::mutex> lk(this->mtx);
+
+    for (auto& ponder : this->ponders) {
+        ponder.results = {};
+    }
+
+    this->guesses.clear();
+};
+
+// Checks if all the searches are finished
+bool Result::is_done() const
+{
+    for (auto d : this->done) {
+        if (!d) {
+            return false;
+        }
+    }
+
+    return true;
+};
+
+// Returns the plausible next pairs from the most likely to the least likely
+// The queue is dealt from a shuffled bag of 64 puyos of each color, "seen" is the count of each color already dealt from the bag
+// The unordered pairs are guessed, since the searches barely depend on the pair's colors order
+std::vector<Guess> get_guesses(const i32 seen[4])
+{
+    std::vector<Guess> result;
+
+    // Counts the remaining puyos in the bag
+    double remain[4] = { 0.0 };
+    double total = 0.0;
+
+    for (i32 i = 0; i < 4; ++i) {
+        remain[i] = double(std::max(64 - seen[i], 0));
+        total += remain[i];
+    }
+
+    // The bag is refilled when it's empty
+    if (total < 2.0) {
+        for (i32 i = 0; i < 4; ++i) {
+            remain[i] = 64.0;
+        }
+
+        total = 256.0;
+    }
+
+    for (i32 a = 0; a < 4; ++a) {
+        for (i32 b = a; b < 4; ++b) {
+            double chance = remain[a] * (a == b ? remain[b] - 1.0 : remain[b] * 2.0) / (total * (total - 1.0));
+
+            if (chance < PONDER_CHANCE_MIN) {
+                continue;
+            }
+
+            result.push_back(Guess {
+                .pair = { cell::Type(a), cell::Type(b) },
+                .chance = chance
+            });
+        }
+    }
+
+    std::stable_sort(
+        result.begin(),
+        result.end(),
+        [] (const Guess& a, const Guess& b) {
+            return a.chance > b.chance;
+        }
+    );
+
+    return result;
 };
 
 };
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "beam/beam.h"
+#include "beam/attack.h"
 #include "dfs/build.h"
 #include "dfs/attack.h"
 
@@ -15,33 +16,126 @@ enum Type
     AC
 };
 
+constexpr size_t COUNT = 4;
+
+// If "plan" is set, the build search follows form templates, see beam::Configs::plan
+// Then ai::get_result() gives the plan of the selected build candidate
+// If "path" is set, the fast search also counts the real input frames of its placements, see dfs::build::Configs::path
+// It's off by default, since the fast weight's tear term was tuned without it
 struct Configs
 {
     beam::eval::Weight build;
     dfs::eval::Weight freestyle;
     dfs::eval::Weight fast;
     dfs::eval::Weight ac;
+    bool plan = false;
+    bool path = false;
+};
+
+// The time limits of the searches in milliseconds
+// A limit of 0 means that the search runs until it's done
+struct Deadlines
+{
+    i32 build = 0;
+    i32 freestyle = 0;
+    i32 fast = 0;
+    i32 ac = 0;
 };
 
+// "done" tells which searches are finished, indexed by Type
+// The unfinished searches hold their best candidates found so far
 struct Result
 {
     beam::Result build;
     dfs::build::Result freestyle;
     dfs::build::Result fast;
     dfs::build::Result ac;
+    bool done[COUNT] = { false, false, false, false };
+public:
+    bool is_done() const;
+};
+
+// The searches of 1 position
+// "results" is empty if the searches aren't started
+struct Job
+{
+    Stop stops[COUNT];
+    std::optional<Result> results = std::nullopt;
 };
 
+// A possible next pair and its chance to be dealt
+struct Guess
+{
+    cell::Pair pair;
+    double chance = 0.0;
+};
+
+// The number of unordered pairs of 4 colors
+constexpr size_t PAIR_COUNT = 10;
+
+// The guesses with lower chances aren't pondered
+constexpr double PONDER_CHANCE_MIN = 0.01;
+
+// Runs the searches concurrently in the background
+// Each search has its own deadline and returns what it found so far when it's out of time or cancelled
+//
+// Ex:
+// thread.search(field, queue, configs, deadlines);
+// ...
+// auto snapshot = thread.poll();  // the best candidates found so far, doesn't block
+// thread.cancel();                // the game state changed, aborts the stale searches
+// auto result = thread.get();     // waits for every search of this position
+//
+// Pondering:
+// After committing a placement, we search the resulting field with every plausible next pair while waiting for it
+// The pairs are searched from the most likely to the least likely, each with a share of the time budget proportional to its chance
+// When the next pair is revealed, get_ponder() returns its results right away if it was pondered
+// If that pair's searches are still running, get_ponder() returns their snapshot and they keep running as the current searches
+// Then get() and poll() give their final results, like after search()
+//
+// Ex:
+// thread.ponder(field, { next_1, next_2 }, configs, 500, seen);
+// ...
+// auto result = thread.get_ponder(next_3);
+// if (!result.has_value()) {
+//     thread.search(field, { next_1, next_2, next_3 }, configs);
+//     result = thread.get();
+// }
+// else if (!result->is_done()) {
+//     result = thread.get();      // or use the snapshot and thread.cancel()
+// }
 class Thread
 {
 private:
-    std::thread* thread;
-    std::optional<Result> results;
+    Pool pool;
+    std::mutex mtx;
+    std::condition_variable cv;
+    Job job;
+    Job ponders[PAIR_COUNT];
+    Job* current;
+    std::vector<Guess> guesses;
+    std::thread* ponder_thread;
+    std::atomic<bool> ponder_cancelled;
+    std::atomic<i32> ponder_keep;
 public:
     Thread();
+    ~Thread();
 public:
-    bool search(Field field, cell::Queue queue, Configs configs);
+    bool search(Field field, cell::Queue queue, Configs configs, Deadlines deadlines = Deadlines());
     std::optional<Result> get();
-    void clear();
+    std::optional<Result> poll();
+    bool is_done();
+    void cancel();
+public:
+    bool ponder(Field field, cell::Queue queue, Configs configs, i32 budget, const i32 seen[4]);
+    std::optional<Result> get_ponder(cell::Pair pair);
+    void cancel_ponder();
+private:
+    void start(Job& job, Field field, cell::Queue queue, Configs configs, Deadlines deadlines);
+    void wait(Job& job);
+    void stop_ponder();
 };
 
+std::vector<Guess> get_guesses(const i32 seen[4]);
+
 };
\ No newline at end of file
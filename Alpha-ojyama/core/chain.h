@@ -43,11 +43,22 @@ inline Score get_score(avec<Field, 19>& mask)
         u32 group_bonus = 0;
 
         for (u8 cell = 0; cell < cell::COUNT - 1; ++cell) {
-            while (!mask[index].data[cell].is_empty())
-            {
-                auto group = mask[index].data[cell].get_mask_group_lsb();
-                mask[index].data[cell] = mask[index].data[cell] & (~group);
-                group_bonus += chain::GROUP_BONUS[std::min(11U, group.get_count())];
+            u32 count = mask[index].data[cell].get_count();
+
+            if (count == 0) {
+                continue;
+            }
+
+            // Popped groups have at least 4 puyos, so less than 8 puyos is always 1 group
+            if (count < 8) {
+                group_bonus += chain::GROUP_BONUS[count];
+                continue;
+            }
+
+            auto sizes = mask[index].data[cell].get_group_sizes();
+
+            for (i32 i = 0; i < sizes.get_size(); ++i) {
+                group_bonus += chain::GROUP_BONUS[std::min(11U, u32(sizes[i]))];
             }
         }
 
@@ -7,4 +7,6 @@
 #include "fieldbit.h"
 #include "field.h"
 #include "chain.h"
-#include "move.h"
\ No newline at end of file
+#include "move.h"
+#include "pool.h"
+#include "stop.h"
\ No newline at end of file
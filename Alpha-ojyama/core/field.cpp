@@ -123,6 +123,110 @@ u8 Field::get_drop_pair_frame(i8 x, direction::Type direction)
     return 1 + (this->get_height(x) != this->get_height(x + direction::get_offset_x(direction)));
 };
 
+// Finds the amount of key puyos needed to trigger a chain for every column and color at once
+// Returns 0 if dropping at most "drop" puyos vertically doesn't trigger anything
+//
+// This is the same as dropping key puyos one by one and flood-filling after each drop, but without simulating anything
+// In a settled field every group is smaller than 4, so we classify the groups by their size (1, 2 or 3+)
+// Then we just sum the sizes of the groups next to the key puyos:
+// - 1 key puyo triggers if its left, right and below groups' sizes sum to 3 or more
+// - 2 key puyos trigger if their 5 neighbors' groups' sizes sum to 2 or more
+// - 3 key puyos trigger if any of their 7 neighbors has the same color
+//
+// Groups are never counted twice when it matters:
+// - the left and right neighbors would need a group of 5 to be connected
+// - if the left and below neighbors are connected, their group's size is already 3
+// - a group touching 2 neighbors of 2 key puyos has at least 2 puyos
+void Field::get_key_need(i32 drop, u8 need[6][cell::COUNT - 1])
+{
+    u8 heights[6];
+    this->get_heights(heights);
+
+    // The key puyos' positions for all columns
+    __m128i full = this->get_mask().data;
+    __m128i k0 = _mm_andnot_si128(full, _mm_add_epi16(full, _mm_set1_epi16(1)));
+    __m128i k1 = _mm_slli_epi16(k0, 1);
+    __m128i k2 = _mm_slli_epi16(k0, 2);
+
+    __m128i one = _mm_set1_epi16(1);
+
+    // Returns 1 in the columns where the key puyo touches the mask
+    auto touch = [&] (__m128i mask, __m128i key) -> __m128i {
+        return _mm_min_epu16(mask & key, one);
+    };
+
+    for (u8 p = 0; p < cell::COUNT - 1; ++p) {
+        __m128i m12 = this->data[p].get_mask_12().data;
+
+        __m128i r = _mm_srli_si128(m12, 2) & m12;
+        __m128i l = _mm_slli_si128(m12, 2) & m12;
+        __m128i u = _mm_srli_epi16(m12, 1) & m12;
+        __m128i d = _mm_slli_epi16(m12, 1) & m12;
+
+        __m128i ud_and = u & d;
+        __m128i lr_and = l & r;
+        __m128i ud_or = u | d;
+        __m128i lr_or = l | r;
+
+        // Puyos with at least 2 connections and their neighbors belong to groups of 3 or more
+        FieldBit m2;
+        m2.data = ud_and | lr_and | (ud_or & lr_or);
+
+        __m128i size_3 = m2.get_expand().data & m12;
+        __m128i size_1 = _mm_andnot_si128(ud_or | lr_or, m12);
+
+        // Encodes each puyo's group size with 2 bits
+        // - size 1: bit 0
+        // - size 2: bit 1
+        // - size 3: bit 0 and bit 1
+        __m128i bit_0 = size_1 | size_3;
+        __m128i bit_1 = _mm_andnot_si128(size_1, m12);
+
+        // Moves the left, right and below neighbors onto the key puyos' positions
+        __m128i bit_0_l = _mm_slli_si128(bit_0, 2);
+        __m128i bit_0_r = _mm_srli_si128(bit_0, 2);
+        __m128i bit_0_d = _mm_slli_epi16(bit_0, 1);
+        __m128i bit_1_l = _mm_slli_si128(bit_1, 2);
+        __m128i bit_1_r = _mm_srli_si128(bit_1, 2);
+        __m128i bit_1_d = _mm_slli_epi16(bit_1, 1);
+
+        // Sums the group sizes around each key puyo
+        __m128i row_0 =
+            touch(bit_0_l, k0) + touch(bit_0_r, k0) + touch(bit_0_d, k0) +
+            _mm_slli_epi16(touch(bit_1_l, k0) + touch(bit_1_r, k0) + touch(bit_1_d, k0), 1);
+
+        __m128i row_1 =
+            touch(bit_0_l, k1) + touch(bit_0_r, k1) +
+            _mm_slli_epi16(touch(bit_1_l, k1) + touch(bit_1_r, k1), 1);
+
+        __m128i row_2 = touch(bit_0_l | bit_1_l | bit_0_r | bit_1_r, k2);
+
+        alignas(16) u16 sum_1[8];
+        alignas(16) u16 sum_2[8];
+        alignas(16) u16 sum_3[8];
+
+        _mm_store_si128((__m128i*)sum_1, row_0);
+        _mm_store_si128((__m128i*)sum_2, _mm_add_epi16(row_0, row_1));
+        _mm_store_si128((__m128i*)sum_3, _mm_add_epi16(_mm_add_epi16(row_0, row_1), row_2));
+
+        for (i8 x = 0; x < 6; ++x) {
+            i32 drop_max = std::min(drop, 12 - i32(heights[x]));
+
+            need[x][p] = 0;
+
+            if (drop_max >= 1 && sum_1[x] >= 3) {
+                need[x][p] = 1;
+            }
+            else if (drop_max >= 2 && sum_2[x] >= 2) {
+                need[x][p] = 2;
+            }
+            else if (drop_max >= 3 && sum_3[x] >= 1) {
+                need[x][p] = 3;
+            }
+        }
+    }
+};
+
 // Checks if a position is occupied
 bool Field::is_occupied(i8 x, i8 y)
 {
@@ -24,6 +24,7 @@ public:
     FieldBit get_mask();
     Field get_mask_pop();
     u8 get_drop_pair_frame(i8 x, direction::Type direction);
+    void get_key_need(i32 drop, u8 need[6][cell::COUNT - 1]);
 public:
     bool is_occupied(i8 x, i8 y);
     bool is_occupied(i8 x, i8 y, u8 heights[6]);
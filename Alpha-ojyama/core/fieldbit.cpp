@@ -291,6 +291,90 @@ FieldBit FieldBit::get_mask_group_lsb()
     return m;
 };
 
+// Returns the sizes of all the groups in the bitfield, only counting the 12 lower rows
+// Instead of flood-filling the groups one by one, we label all of them at once:
+// - every column is split into vertical runs of bits
+// - runs that touch each other in neighboring columns are merged using union-find
+// - a group's size is the sum of its runs' sizes
+//
+// Ex:
+// ......     ......
+// .X..X.     .B..D.
+// XX.XX. ->  AB.CD. -> runs A, B, C, D -> groups AB, CD -> sizes 3, 4
+// ...X..     ...C..
+avec<u8, 36> FieldBit::get_group_sizes()
+{
+    alignas(16) u16 v[8];
+    _mm_store_si128((__m128i*)v, this->get_mask_12().data);
+
+    // There are at most 6 runs per column in 12 rows
+    u16 runs[36];
+    u8 parents[36];
+    u8 sizes[36];
+    i32 count = 0;
+
+    i32 begin[7] = { 0 };
+
+    for (i8 x = 0; x < 6; ++x) {
+        begin[x] = count;
+
+        u32 col = v[x];
+
+        while (col != 0) {
+            // Adding the lowest bit carries through the lowest run and clears it
+            u32 run = col & ~(col + (col & (~col + 1)));
+            col &= ~run;
+
+            runs[count] = u16(run);
+            parents[count] = u8(count);
+            sizes[count] = u8(std::popcount(run));
+            count += 1;
+        }
+    }
+
+    begin[6] = count;
+
+    auto find = [&] (i32 i) -> i32 {
+        while (parents[i] != i) {
+            parents[i] = parents[parents[i]];
+            i = parents[i];
+        }
+
+        return i;
+    };
+
+    // Merges the runs that touch in neighboring columns
+    for (i8 x = 1; x < 6; ++x) {
+        for (i32 a = begin[x - 1]; a < begin[x]; ++a) {
+            for (i32 b = begin[x]; b < begin[x + 1]; ++b) {
+                if ((runs[a] & runs[b]) == 0) {
+                    continue;
+                }
+
+                i32 root_a = find(a);
+                i32 root_b = find(b);
+
+                if (root_a == root_b) {
+                    continue;
+                }
+
+                parents[root_b] = u8(root_a);
+                sizes[root_a] += sizes[root_b];
+            }
+        }
+    }
+
+    avec<u8, 36> result = avec<u8, 36>();
+
+    for (i32 i = 0; i < count; ++i) {
+        if (parents[i] == i) {
+            result.add(sizes[i]);
+        }
+    }
+
+    return result;
+};
+
 // Returns if the bitfield is empty
 bool FieldBit::is_empty()
 {
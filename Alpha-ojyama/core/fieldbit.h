@@ -1,6 +1,7 @@
 #pragma once
 
 #include "def.h"
+#include "avec.h"
 #include "cell.h"
 #include "direction.h"
 
@@ -29,6 +30,7 @@ public:
     FieldBit get_mask_group(i8 x, i8 y);
     FieldBit get_mask_group_4(i8 x, i8 y);
     FieldBit get_mask_group_lsb();
+    avec<u8, 36> get_group_sizes();
 public:
     bool is_empty();
 public:
@@ -0,0 +1,271 @@
+#pragma once
+
+#include "def.h"
+#include <deque>
+
+// A small work-stealing thread pool
+// Every thread has its own deque of tasks:
+// - a thread pushes and pops its own tasks at the back, so it keeps working on the subtree it just split
+// - an idle thread steals from the front of the others' deques, where the oldest and usually biggest tasks are
+// Tasks may submit more tasks, and the thread that calls wait() helps running them, then sleeps until the last task is done
+//
+// Ex:
+// Pool pool(8);
+// pool.submit([&] () { ... pool.submit(...); ... });
+// pool.wait();
+//
+// Groups:
+// A search running on a long-lived pool, or inside one of its tasks, can't wait for the whole pool
+// Instead, it submits its tasks to its own group and waits for that group only
+// While waiting, it only helps running its group's tasks, so it's never stuck in an unrelated long task
+//
+// Ex:
+// Pool::Group group;
+// pool.submit([&] () { ... pool.submit(..., &group); ... }, &group);
+// pool.wait(group);
+class Pool
+{
+public:
+    typedef std::function<void()> Task;
+
+    struct Group
+    {
+        std::atomic<i32> queued = 0;
+        std::atomic<i32> pending = 0;
+    };
+
+    struct Item
+    {
+        Task task;
+        Group* group = nullptr;
+    };
+
+    struct Queue
+    {
+        std::deque<Item> tasks;
+        std::mutex mtx;
+    };
+public:
+    std::vector<std::thread> threads;
+    std::vector<Queue> queues;
+    std::atomic<i32> queued = 0;
+    std::atomic<i32> pending = 0;
+    std::atomic<u32> next = 0;
+    std::atomic<bool> stop = false;
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::condition_variable cv_group;
+public:
+    Pool(i32 thread_count);
+    ~Pool();
+public:
+    void submit(Task task, Group* group = nullptr);
+    void wait();
+    void wait(Group& group);
+    bool run(i32 index, Group* group = nullptr);
+public:
+    static i32& get_index();
+    static Pool*& get_current();
+};
+
+// Creates the pool with "thread_count" threads in total, including the thread calling wait()
+inline Pool::Pool(i32 thread_count) : queues(std::max(thread_count, 1))
+{
+    for (i32 i = 1; i < i32(this->queues.size()); ++i) {
+        this->threads.emplace_back([this] (i32 index) {
+            Pool::get_current() = this;
+            Pool::get_index() = index;
+
+            while (true)
+            {
+                if (this->run(index)) {
+                    continue;
+                }
+
+                std::unique_lock<std::mutex> lk(this->mtx);
+                this->cv.wait(lk, [&] { return this->stop || this->queued > 0; });
+
+                if (this->stop) {
+                    break;
+                }
+            }
+        }, i);
+    }
+};
+
+inline Pool::~Pool()
+{
+    {
+        std::lock_guard<std::mutex> lk(this->mtx);
+        this->stop = true;
+    }
+
+    this->cv.notify_all();
+
+    for (auto& t : this->threads) {
+        t.join();
+    }
+};
+
+// Adds a task, to "group" if it's set
+// Tasks submitted from the pool's threads go to their own deque, the others are spread over all the deques
+inline void Pool::submit(Task task, Group* group)
+{
+    i32 index = Pool::get_current() == this ? Pool::get_index() : i32(this->next++ % this->queues.size());
+
+    // Counts the task first, so that wait() can't see 0 pending tasks while this one is being pushed
+    this->pending += 1;
+
+    if (group != nullptr) {
+        group->pending += 1;
+    }
+
+    {
+        std::lock_guard<std::mutex> lk(this->mtx);
+        this->queued += 1;
+
+        if (group != nullptr) {
+            group->queued += 1;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lk(this->queues[index].mtx);
+        this->queues[index].tasks.push_back(Item { .task = std::move(task), .group = group });
+    }
+
+    this->cv.notify_one();
+
+    // The threads waiting for a group only run its tasks, so they all check if it's theirs
+    if (group != nullptr) {
+        this->cv_group.notify_all();
+    }
+};
+
+// Runs tasks until every submitted task is done
+inline void Pool::wait()
+{
+    auto current = Pool::get_current();
+    auto index = Pool::get_index();
+
+    Pool::get_current() = this;
+    Pool::get_index() = 0;
+
+    while (true)
+    {
+        if (this->run(0)) {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lk(this->mtx);
+        this->cv.wait(lk, [&] { return this->pending == 0 || this->queued > 0; });
+
+        if (this->pending == 0) {
+            break;
+        }
+    }
+
+    Pool::get_current() = current;
+    Pool::get_index() = index;
+};
+
+// Runs the group's tasks until they are all done
+// The pool's threads keep their own deque, the other threads use the deque 0 like wait()
+inline void Pool::wait(Group& group)
+{
+    auto current = Pool::get_current();
+    auto index = Pool::get_index();
+
+    if (current != this) {
+        Pool::get_current() = this;
+        Pool::get_index() = 0;
+    }
+
+    while (true)
+    {
+        if (this->run(Pool::get_index(), &group)) {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lk(this->mtx);
+        this->cv_group.wait(lk, [&] { return group.pending == 0 || group.queued > 0; });
+
+        if (group.pending == 0) {
+            break;
+        }
+    }
+
+    Pool::get_current() = current;
+    Pool::get_index() = index;
+};
+
+// Runs 1 task from our own deque, or steals 1 from the others
+// If "group" is set, only that group's tasks are run
+// Returns false if there wasn't any task
+inline bool Pool::run(i32 index, Group* group)
+{
+    Item item;
+    bool found = false;
+
+    for (i32 i = 0; i < i32(this->queues.size()) && !found; ++i) {
+        auto& queue = this->queues[(index + i) % this->queues.size()];
+
+        std::lock_guard<std::mutex> lk(queue.mtx);
+
+        // Our own tasks are taken from the back, the stolen ones from the front
+        for (size_t k = 0; k < queue.tasks.size(); ++k) {
+            auto it = i == 0 ? queue.tasks.end() - 1 - k : queue.tasks.begin() + k;
+
+            if (group != nullptr && it->group != group) {
+                continue;
+            }
+
+            item = std::move(*it);
+            queue.tasks.erase(it);
+
+            found = true;
+            break;
+        }
+    }
+
+    if (!found) {
+        return false;
+    }
+
+    this->queued -= 1;
+
+    if (item.group != nullptr) {
+        item.group->queued -= 1;
+    }
+
+    item.task();
+
+    // Wakes up the threads waiting for the group after its last task
+    // The group may be destroyed as soon as its pending count is 0, so it's not used after
+    if (item.group != nullptr && --item.group->pending == 0) {
+        std::lock_guard<std::mutex> lk(this->mtx);
+        this->cv_group.notify_all();
+    }
+
+    // Wakes up wait() after the last task
+    if (--this->pending == 0) {
+        std::lock_guard<std::mutex> lk(this->mtx);
+        this->cv.notify_all();
+    }
+
+    return true;
+};
+
+// The index of the current thread in its pool
+inline i32& Pool::get_index()
+{
+    thread_local i32 index = 0;
+    return index;
+};
+
+// The pool the current thread is working for
+inline Pool*& Pool::get_current()
+{
+    thread_local Pool* current = nullptr;
+    return current;
+};
\ No newline at end of file
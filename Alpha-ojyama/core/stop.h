@@ -0,0 +1,43 @@
+#pragma once
+
+#include "def.h"
+
+// Stops a search early, when it's cancelled or when its deadline has passed
+// The searches check it between their units of work and return what they found so far
+// The deadline must be set before the search starts
+class Stop
+{
+public:
+    std::atomic<bool> cancelled = false;
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+public:
+    void reset(i32 ms = 0);
+    void cancel();
+    bool is_stopped();
+};
+
+// Clears the cancellation and sets the deadline to "ms" milliseconds from now
+// If "ms" is 0, there isn't any deadline
+inline void Stop::reset(i32 ms)
+{
+    this->cancelled = false;
+    this->deadline = std::chrono::steady_clock::time_point::max();
+
+    if (ms > 0) {
+        this->deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+    }
+};
+
+inline void Stop::cancel()
+{
+    this->cancelled = true;
+};
+
+inline bool Stop::is_stopped()
+{
+    if (this->cancelled) {
+        return true;
+    }
+
+    return std::chrono::steady_clock::now() >= this->deadline;
+};
\ No newline at end of file
@@ -119,13 +119,20 @@ int main(int argc, char** argv)
     save_json();
     load_json(w);
 
+    // Loads the path finder's table, see path::get_table()
+    path::get_table();
+
     u32 seed = rand() & 0xFFFF;
     seed = rand() & 0xFFFF;
 
-    if (argc == 2) {
+    if (argc >= 2) {
         seed = std::atoi(argv[1]);
     }
 
+    // "puyop <seed> plan" follows form templates while building
+    beam::Configs configs;
+    configs.plan = argc >= 3 && std::string(argv[2]) == "plan";
+
     printf("seed: %d\n", seed);
 
     auto queue = cell::create_queue(seed);
@@ -304,7 +311,7 @@ int main(int argc, char** argv)
 
         // AI thinking (unchanged)
         auto time_start = chrono::high_resolution_clock::now();
-        auto ai_result = beam::search_multi(field, tqueue, w);
+        auto ai_result = beam::search_multi(field, tqueue, w, configs);
         auto time_stop = chrono::high_resolution_clock::now();
         auto dt = chrono::duration_cast<chrono::milliseconds>(time_stop - time_start).count();
         time += dt;
@@ -341,7 +348,7 @@ int main(int argc, char** argv)
             stopped_by_game_over = true;
             break;
         } else {
-            auto mv = ai_result.candidates[0];
+            auto mv = ai::get_result(ai_result);
             field.drop_pair(mv.placement.x, mv.placement.r, tqueue[0]);
             auto mask = field.pop();
             auto chain = chain::get_score(mask);
@@ -362,7 +369,7 @@ int main(int argc, char** argv)
 
             push_control_entry(control_queue, control_placements, control_field_snapshots, field, tqueue[0], mv.placement);
 
-            printf("[move %d] AI placed (ets: %d) - %d ms\n", logical, mv.score / beam::BRANCH, dt);
+            printf("[move %d] AI placed (ets: %d%s) - %d ms\n", logical, int(ai_result.candidates[0].score / beam::BRANCH), mv.plan.has_value() ? ", plan" : "", dt);
 
             // Debug: show heights & viewer URL after placement/pop
             {
@@ -1,16 +1,7 @@
+#include <random>
 #include "../core/core.h"
 #include "../ai/ai.h"
 
-void load_json(beam::eval::Weight& h)
-{
-    std::ifstream file;
-    file.open("config.json");
-    json js;
-    file >> js;
-    file.close();
-    from_json(js, h);
-};
-
 void save_json()
 {
     std::ifstream f("config.json");
@@ -26,26 +17,79 @@ void save_json()
     o.close();
 };
 
-inline chain::Score get_score(beam::eval::Weight w, u32 seed)
+// Loads a weight from a config file
+// The file can hold the weight itself, or the weight profiles like the bot's config.json, then we use the build profile
+bool load_weight(const std::string& path, beam::eval::Weight& w)
+{
+    std::ifstream file(path);
+
+    if (!file.good()) {
+        return false;
+    }
+
+    json js;
+    file >> js;
+    file.close();
+
+    if (js.contains("build")) {
+        js = js["build"];
+    }
+
+    from_json(js, w);
+
+    return true;
+};
+
+// A played game
+// "frame" is the frames spent until the biggest chain was triggered
+// "latencies" are the search times of every move in microseconds
+// "plan" is the number of moves that followed a form template, see beam::Configs::plan
+struct Game
+{
+    u32 seed = 0;
+    chain::Score chain = chain::Score();
+    i32 frame = 0;
+    i32 move = 0;
+    i32 plan = 0;
+    std::vector<i64> latencies;
+};
+
+// Plays a game until a chain of "trigger" points or "move_count" moves
+Game play(beam::eval::Weight w, u32 seed, beam::Configs configs, i32 move_count = 50, i32 trigger = 80000)
 {
-    auto score = chain::Score();
+    auto game = Game();
+    game.seed = seed;
+    game.latencies.reserve(move_count);
 
     auto field = Field();
     auto queue = cell::create_queue(seed);
 
-    for (i32 i = 0; i < 50; ++i) {
+    i32 frame = 0;
+
+    for (i32 i = 0; i < move_count; ++i) {
         cell::Queue q = {
             queue[(i + 0) % 128],
             queue[(i + 1) % 128]
         };
 
-        auto ai = beam::search_multi(field, q, w);
+        auto time_start = std::chrono::steady_clock::now();
+
+        auto ai = beam::search_multi(field, q, w, configs);
+
+        auto time_stop = std::chrono::steady_clock::now();
+
+        game.latencies.push_back(std::chrono::duration_cast<std::chrono::microseconds>(time_stop - time_start).count());
+        game.move += 1;
 
         if (ai.candidates.empty()) {
             break;
         }
 
-        auto mv = ai.candidates.front();
+        auto mv = ai::get_result(ai);
+
+        game.plan += mv.plan.has_value();
+
+        frame += field.get_drop_pair_frame(mv.placement.x, mv.placement.r);
 
         field.drop_pair(mv.placement.x, mv.placement.r, q[0]);
 
@@ -56,101 +100,709 @@ inline chain::Score get_score(beam::eval::Weight w, u32 seed)
             break;
         }
 
-        if (chain.score > score.score) {
-            score = chain;
+        if (chain.score > game.chain.score) {
+            game.chain = chain;
+            game.frame = frame;
         }
 
-        if (chain.score >= 80000) {
+        if (chain.score >= trigger) {
             break;
         }
+
+        frame += chain.count * 2;
     }
 
-    return score;
+    return game;
 };
 
-int main()
+// A weight and the search configs it plays with
+struct Player
 {
     beam::eval::Weight w;
-    save_json();
-    load_json(w);
+    beam::Configs configs;
+};
 
-    srand(uint32_t(time(NULL)));
+// Plays the seeds [first, first + count) with every player, on "thread_count" games at once
+// The players' games of a seed are scheduled one after the other, so they run under the same load
+// Every thread takes the next unplayed game when it's done with a game, and keeps its games in its own buffer
+// Returns every player's games in seed order
+std::vector<std::vector<Game>> play_all(const std::vector<Player>& players, u32 first, i32 count, i32 thread_count)
+{
+    const i32 total = count * i32(players.size());
 
-    const i32 POPULATION_SIZE = 200;
+    std::vector<std::vector<std::pair<size_t, Game>>> buffers(thread_count);
+    std::atomic<i32> next = 0;
+    std::atomic<i32> progress = 0;
 
-    u32 seeds[POPULATION_SIZE];
+    Pool pool(thread_count);
 
-    for (i32 i = 0; i < POPULATION_SIZE; ++i) {
-        seeds[i] = rand() & 0xFFFF;
-    }
+    for (i32 t = 0; t < thread_count; ++t) {
+        pool.submit([&, t] () {
+            while (true)
+            {
+                i32 index = next++;
 
-    std::atomic<i32> progress = 0;
-    std::vector<std::thread> threads;
+                if (index >= total) {
+                    break;
+                }
 
-    std::atomic<i32> map_count[20] = { 0 };
-    std::atomic<i32> map_score[POPULATION_SIZE] = { 0 };
+                size_t player = size_t(index) % players.size();
+                u32 seed = first + u32(size_t(index) / players.size());
 
-    struct FailedSeed
-    {
-        u32 seed = ~0;
-        i32 score = 0;
-    };
+                buffers[t].push_back({ player, play(players[player].w, seed, players[player].configs) });
 
-    std::vector<FailedSeed> failed_seed = {};
+                fprintf(stderr, "\rprogress: %d/%d", ++progress, total);
+            }
+        });
+    }
 
-    for (i32 t = 0; t < 4; ++t) {
-        threads.emplace_back([&] (i32 tid) {
-            for (i32 i = 0; i < POPULATION_SIZE / 4; ++i) {
-                auto seed = seeds[tid * POPULATION_SIZE / 4 + i];
+    pool.wait();
 
-                auto score = get_score(w, seed);
+    fprintf(stderr, "\n");
 
-                map_count[score.count] += 1;
-                map_score[tid * POPULATION_SIZE / 4 + i] = score.score;
+    std::vector<std::vector<Game>> result(players.size());
 
-                if (score.score < 90000) {
-                    failed_seed.push_back(FailedSeed { .seed = seeds[tid * POPULATION_SIZE / 4 + i], .score = score.score });
-                }
+    for (auto& buffer : buffers) {
+        for (auto& [player, game] : buffer) {
+            result[player].push_back(std::move(game));
+        }
+    }
 
-                progress += 1;
-                printf("\rprogress: %d", progress.load());
+    for (auto& games : result) {
+        std::sort(
+            games.begin(),
+            games.end(),
+            [] (const Game& a, const Game& b) {
+                return a.seed < b.seed;
             }
-        }, t);
+        );
     }
 
-    for (auto& thread : threads) {
-        thread.join();
+    return result;
+};
+
+// Gets the value below which "p" percent of the values are, with linear interpolation
+double get_percentile(std::vector<double> values, double p)
+{
+    if (values.empty()) {
+        return 0.0;
     }
 
-    std::string out_str;
+    std::sort(values.begin(), values.end());
+
+    double rank = p / 100.0 * double(values.size() - 1);
+    size_t low = size_t(rank);
+    size_t high = std::min(low + 1, values.size() - 1);
+
+    return values[low] + (values[high] - values[low]) * (rank - double(low));
+};
+
+json get_percentiles(const std::vector<double>& values)
+{
+    json js;
 
-    for (i32 i = 0; i < 20; ++i) {
-        out_str += std::to_string(map_count[i].load()) + "\n";
+    for (i32 p : { 10, 25, 50, 75, 90, 99 }) {
+        js["p" + std::to_string(p)] = get_percentile(values, double(p));
     }
 
-    out_str += "\n";
+    return js;
+};
+
+// Summarizes the games
+// - chains: the number of games by their biggest chain's length
+// - success: the ratio of games with a chain of at least 80000 and 100000 points
+// - failed: the seeds whose biggest chain is under 90000 points, from the worst
+json get_report(std::vector<Game>& games, i64 time, i32 thread_count)
+{
+    std::vector<double> scores;
+    std::vector<double> frames;
+    std::vector<double> latencies;
+    std::vector<i32> chains(20, 0);
+    std::vector<std::pair<i32, u32>> failed;
+
+    i64 move_count = 0;
+    i64 plan_count = 0;
+    i32 success_80k = 0;
+    i32 success_100k = 0;
+
+    for (auto& game : games) {
+        scores.push_back(double(game.chain.score));
+        chains[std::clamp(game.chain.count, 0, 19)] += 1;
+
+        if (game.chain.score > 0) {
+            frames.push_back(double(game.frame));
+        }
+
+        success_80k += game.chain.score >= 80000;
+        success_100k += game.chain.score >= 100000;
 
-    for (i32 i = 0; i < POPULATION_SIZE; ++i) {
-        out_str += std::to_string(map_score[i].load()) + "\n";
+        if (game.chain.score < 90000) {
+            failed.push_back({ game.chain.score, game.seed });
+        }
+
+        for (auto latency : game.latencies) {
+            latencies.push_back(double(latency) / 1000.0);
+        }
+
+        move_count += game.move;
+        plan_count += game.plan;
     }
 
-    out_str += "\n";
+    std::sort(failed.begin(), failed.end());
+
+    json js;
+
+    js["games"] = games.size();
+    js["threads"] = thread_count;
+    js["time_ms"] = time;
+    js["chains"] = chains;
+    js["success"]["80k"] = double(success_80k) / double(std::max<size_t>(games.size(), 1));
+    js["success"]["100k"] = double(success_100k) / double(std::max<size_t>(games.size(), 1));
+    js["score"] = get_percentiles(scores);
+    js["score"]["mean"] = scores.empty() ? 0.0 : std::accumulate(scores.begin(), scores.end(), 0.0) / double(scores.size());
+    js["frame_trigger"] = get_percentiles(frames);
+    js["moves"] = move_count;
+    js["plan_moves"] = plan_count;
+    js["moves_per_second"] = double(move_count) * 1000.0 / double(std::max<i64>(time, 1));
+    js["latency_ms"] = get_percentiles(latencies);
+    js["latency_ms"]["max"] = latencies.empty() ? 0.0 : *std::max_element(latencies.begin(), latencies.end());
+
+    js["failed"] = json::array();
+
+    for (auto& [score, seed] : failed) {
+        js["failed"].push_back({ { "seed", seed }, { "score", score } });
+    }
 
-    std::sort(
-        failed_seed.begin(),
-        failed_seed.end(),
-        [&] (FailedSeed a, FailedSeed b) {
-            return a.score < b.score;
+    return js;
+};
+
+// Saves every game as a row
+void save_csv(const std::string& path, std::vector<Game>& games)
+{
+    std::ofstream o(path);
+
+    o << "seed,chain,score,frame,moves,plan_moves,latency_mean_us,latency_max_us\n";
+
+    for (auto& game : games) {
+        i64 latency_sum = 0;
+        i64 latency_max = 0;
+
+        for (auto latency : game.latencies) {
+            latency_sum += latency;
+            latency_max = std::max(latency_max, latency);
         }
-    );
 
-    for (i32 i = 0; i < failed_seed.size(); ++i) {
-        out_str += std::to_string(failed_seed[i].seed) + " " + std::to_string(failed_seed[i].score) + "\n";
+        o << game.seed << ",";
+        o << game.chain.count << ",";
+        o << game.chain.score << ",";
+        o << game.frame << ",";
+        o << game.move << ",";
+        o << game.plan << ",";
+        o << latency_sum / std::max<i64>(game.latencies.size(), 1) << ",";
+        o << latency_max << "\n";
+    }
+
+    o.close();
+};
+
+// The options of the benchmarks, parsed from "--name value" arguments
+// The "_b" options are the second player's in the A/B comparison, they default to the first player's
+struct Options
+{
+    std::string weight = "config.json";
+    std::string weight_b;
+    u32 first = 0;
+    i32 count = 200;
+    i32 threads = 0;
+    size_t width = beam::Configs().width;
+    size_t depth = beam::Configs().depth;
+    size_t width_b = 0;
+    size_t depth_b = 0;
+    bool plan = false;
+    i32 resample = 2000;
+    double tolerance = 0.05;
+    std::string json;
+    std::string csv;
+};
+
+Options get_options(int argc, char** argv, int start)
+{
+    auto options = Options();
+
+    for (int i = start; i + 1 < argc; i += 2) {
+        std::string name = argv[i];
+        std::string value = argv[i + 1];
+
+        if (name == "--weight") options.weight = value;
+        else if (name == "--first") options.first = u32(std::stoul(value));
+        else if (name == "--count") options.count = std::stoi(value);
+        else if (name == "--threads") options.threads = std::stoi(value);
+        else if (name == "--width") options.width = std::stoul(value);
+        else if (name == "--depth") options.depth = std::stoul(value);
+        else if (name == "--plan") options.plan = value == "1";
+        else if (name == "--weight_b") options.weight_b = value;
+        else if (name == "--width_b") options.width_b = std::stoul(value);
+        else if (name == "--depth_b") options.depth_b = std::stoul(value);
+        else if (name == "--resample") options.resample = std::stoi(value);
+        else if (name == "--tolerance") options.tolerance = std::stod(value);
+        else if (name == "--json") options.json = value;
+        else if (name == "--csv") options.csv = value;
+        else printf("unknown option %s\n", name.c_str());
+    }
+
+    // Each game's searches already run on beam::BRANCH threads
+    if (options.threads <= 0) {
+        options.threads = std::max(i32(std::thread::hardware_concurrency()) / i32(beam::BRANCH), 1);
+    }
+
+    if (options.weight_b.empty()) options.weight_b = options.weight;
+    if (options.width_b == 0) options.width_b = options.width;
+    if (options.depth_b == 0) options.depth_b = options.depth;
+
+    return options;
+};
+
+// Measures the chains and the speed of the bot on a range of seeds
+// Saves a json report and a csv of every game
+int bench(Options options)
+{
+    if (options.json.empty()) options.json = "bench.json";
+    if (options.csv.empty()) options.csv = "bench.csv";
+
+    auto w = beam::eval::Weight();
+
+    if (!load_weight(options.weight, w)) {
+        printf("can't load %s\n", options.weight.c_str());
+        return -1;
     }
 
-    std::ofstream o("out.txt");
-    o << out_str << std::endl;
+    auto configs = beam::Configs();
+    configs.width = options.width;
+    configs.depth = options.depth;
+    configs.plan = options.plan;
+
+    auto time_start = std::chrono::steady_clock::now();
+
+    auto games = play_all({ Player { .w = w, .configs = configs } }, options.first, options.count, options.threads)[0];
+
+    auto time_stop = std::chrono::steady_clock::now();
+    auto time = std::chrono::duration_cast<std::chrono::milliseconds>(time_stop - time_start).count();
+
+    auto report = get_report(games, time, options.threads);
+
+    std::ofstream o(options.json);
+    o << std::setw(4) << report << std::endl;
     o.close();
 
+    save_csv(options.csv, games);
+
+    printf("games: %zu\n", games.size());
+    printf("success: 80k %.1f%% | 100k %.1f%%\n", double(report["success"]["80k"]) * 100.0, double(report["success"]["100k"]) * 100.0);
+    printf("score: mean %.0f | median %.0f\n", double(report["score"]["mean"]), double(report["score"]["p50"]));
+    printf("moves per second: %.1f\n", double(report["moves_per_second"]));
+    printf("latency: median %.1f ms | p99 %.1f ms\n", double(report["latency_ms"]["p50"]), double(report["latency_ms"]["p99"]));
+    printf("saved %s and %s\n", options.json.c_str(), options.csv.c_str());
+
     return 0;
+};
+
+// The mean of paired differences with its bootstrap confidence interval
+struct Interval
+{
+    double mean = 0.0;
+    double low = 0.0;
+    double high = 0.0;
+};
+
+// Resamples the seeds with replacement "resample" times and takes the 2.5th and 97.5th percentiles of the mean difference
+// The generator's seed is fixed, so the same games always give the same interval
+Interval get_interval(const std::vector<double>& diffs, i32 resample)
+{
+    auto result = Interval();
+
+    if (diffs.empty()) {
+        return result;
+    }
+
+    result.mean = std::accumulate(diffs.begin(), diffs.end(), 0.0) / double(diffs.size());
+
+    std::mt19937 rng = std::mt19937(0);
+    std::uniform_int_distribution<size_t> pick(0, diffs.size() - 1);
+
+    std::vector<double> means;
+    means.reserve(resample);
+
+    for (i32 i = 0; i < resample; ++i) {
+        double sum = 0.0;
+
+        for (size_t k = 0; k < diffs.size(); ++k) {
+            sum += diffs[pick(rng)];
+        }
+
+        means.push_back(sum / double(diffs.size()));
+    }
+
+    result.low = get_percentile(means, 2.5);
+    result.high = get_percentile(means, 97.5);
+
+    return result;
+};
+
+json get_json(const Interval& interval)
+{
+    return json {
+        { "mean", interval.mean },
+        { "low", interval.low },
+        { "high", interval.high }
+    };
+};
+
+// Compares 2 players seed by seed, A being the baseline and B the change
+// Both players play the same seeds at the same time, see play_all()
+// The differences are B - A for:
+// - success: reaching a chain of 100000 points
+// - score: the biggest chain's score
+// - latency: the mean search time per move in ms
+// Returns 1 if B is worse than A with 95% confidence, that is if the interval of success or score is below 0, or the interval of latency is above "tolerance" times A's mean latency
+int ab(Options options)
+{
+    if (options.json.empty()) options.json = "ab.json";
+    if (options.csv.empty()) options.csv = "ab.csv";
+
+    std::vector<Player> players(2);
+
+    for (auto& [player, path, width, depth] : {
+        std::tuple { &players[0], options.weight, options.width, options.depth },
+        std::tuple { &players[1], options.weight_b, options.width_b, options.depth_b }
+    }) {
+        if (!load_weight(path, player->w)) {
+            printf("can't load %s\n", path.c_str());
+            return -1;
+        }
+
+        player->configs.width = width;
+        player->configs.depth = depth;
+        player->configs.plan = options.plan;
+    }
+
+    auto time_start = std::chrono::steady_clock::now();
+
+    auto games = play_all(players, options.first, options.count, options.threads);
+
+    auto time_stop = std::chrono::steady_clock::now();
+    auto time = std::chrono::duration_cast<std::chrono::milliseconds>(time_stop - time_start).count();
+
+    auto get_latency = [] (const Game& game) {
+        return game.latencies.empty() ? 0.0 : double(std::accumulate(game.latencies.begin(), game.latencies.end(), i64(0))) / double(game.latencies.size()) / 1000.0;
+    };
+
+    std::vector<double> diff_success;
+    std::vector<double> diff_score;
+    std::vector<double> diff_latency;
+
+    double latency_a = 0.0;
+
+    for (size_t k = 0; k < games[0].size(); ++k) {
+        auto& a = games[0][k];
+        auto& b = games[1][k];
+
+        diff_success.push_back(double(b.chain.score >= 100000) - double(a.chain.score >= 100000));
+        diff_score.push_back(double(b.chain.score - a.chain.score));
+        diff_latency.push_back(get_latency(b) - get_latency(a));
+
+        latency_a += get_latency(a);
+    }
+
+    latency_a /= double(std::max<size_t>(games[0].size(), 1));
+
+    auto success = get_interval(diff_success, options.resample);
+    auto score = get_interval(diff_score, options.resample);
+    auto latency = get_interval(diff_latency, options.resample);
+
+    std::vector<std::string> regressions;
+
+    if (success.high < 0.0) regressions.push_back("success");
+    if (score.high < 0.0) regressions.push_back("score");
+    if (latency.low > latency_a * options.tolerance) regressions.push_back("latency");
+
+    json report;
+
+    report["a"] = get_report(games[0], time, options.threads);
+    report["b"] = get_report(games[1], time, options.threads);
+    report["diff"]["success_100k"] = get_json(success);
+    report["diff"]["score"] = get_json(score);
+    report["diff"]["latency_ms"] = get_json(latency);
+    report["resample"] = options.resample;
+    report["regressions"] = regressions;
+
+    std::ofstream o(options.json);
+    o << std::setw(4) << report << std::endl;
+    o.close();
+
+    std::ofstream csv(options.csv);
+
+    csv << "seed,score_a,score_b,chain_a,chain_b,latency_a_ms,latency_b_ms\n";
+
+    for (size_t k = 0; k < games[0].size(); ++k) {
+        auto& a = games[0][k];
+        auto& b = games[1][k];
+
+        csv << a.seed << ",";
+        csv << a.chain.score << "," << b.chain.score << ",";
+        csv << a.chain.count << "," << b.chain.count << ",";
+        csv << get_latency(a) << "," << get_latency(b) << "\n";
+    }
+
+    csv.close();
+
+    printf("games: %zu\n", games[0].size());
+    printf("success 100k: %+.1f%% [%+.1f%%, %+.1f%%]\n", success.mean * 100.0, success.low * 100.0, success.high * 100.0);
+    printf("score: %+.0f [%+.0f, %+.0f]\n", score.mean, score.low, score.high);
+    printf("latency: %+.2f ms [%+.2f, %+.2f]\n", latency.mean, latency.low, latency.high);
+    printf("saved %s and %s\n", options.json.c_str(), options.csv.c_str());
+
+    if (!regressions.empty()) {
+        for (auto& regression : regressions) {
+            printf("regression: %s\n", regression.c_str());
+        }
+
+        return 1;
+    }
+
+    return 0;
+};
+
+// Measures how many paths the path finder computes per second
+// The fields are played with the first placement of every pair, so that they get tall and bumpy like in real games
+void bench_path()
+{
+    std::vector<std::pair<Field, cell::Pair>> positions;
+
+    for (u32 seed = 0; seed < 64; ++seed) {
+        auto field = Field();
+        auto queue = cell::create_queue(seed);
+
+        for (i32 i = 0; i < 40; ++i) {
+            auto placements = move::generate(field, queue[i].first == queue[i].second);
+
+            if (placements.get_size() == 0) {
+                break;
+            }
+
+            positions.push_back({ field, queue[i] });
+
+            auto placement = placements[(seed + i * 7) % placements.get_size()];
+
+            field.drop_pair(placement.x, placement.r, queue[i]);
+            field.pop();
+
+            if (field.get_height(2) > 11) {
+                break;
+            }
+        }
+    }
+
+    auto bench = [&] (const char* name) {
+        i64 count = 0;
+        size_t checksum = 0;
+
+        auto time_start = std::chrono::high_resolution_clock::now();
+
+        for (auto& [field, pair] : positions) {
+            auto placements = move::generate(field, pair.first == pair.second);
+
+            for (i32 i = 0; i < placements.get_size(); ++i) {
+                checksum += path::Finder::find(field, placements[i], pair).size();
+                count += 1;
+            }
+        }
+
+        auto time_stop = std::chrono::high_resolution_clock::now();
+        auto time = std::chrono::duration_cast<std::chrono::microseconds>(time_stop - time_start).count();
+
+        printf("%s\n", name);
+        printf("    paths: %lld\n", (long long)count);
+        printf("    time: %lld us\n", (long long)time);
+        printf("    paths per second: %.0f\n", double(count) * 1000000.0 / double(std::max<i64>(time, 1)));
+        printf("    checksum: %zu\n", checksum);
+        printf("    stack overflows: %llu\n", (unsigned long long)path::Finder::overflow.load());
+    };
+
+    // Gets the frames of all the placements at once, and checks them against the paths' lengths
+    auto bench_frames = [&] (const char* name) {
+        std::vector<path::Frames> frames;
+        frames.reserve(positions.size());
+
+        auto time_start = std::chrono::high_resolution_clock::now();
+
+        for (auto& [field, pair] : positions) {
+            frames.push_back(path::Finder::get_frames(field, pair.first == pair.second));
+        }
+
+        auto time_stop = std::chrono::high_resolution_clock::now();
+        auto time = std::chrono::duration_cast<std::chrono::microseconds>(time_stop - time_start).count();
+
+        i64 mismatch = 0;
+
+        for (size_t k = 0; k < positions.size(); ++k) {
+            auto& [field, pair] = positions[k];
+            auto placements = move::generate(field, pair.first == pair.second);
+
+            for (i32 i = 0; i < placements.get_size(); ++i) {
+                mismatch += frames[k].get(placements[i]) != path::Finder::find(field, placements[i], pair).size();
+            }
+        }
+
+        printf("%s\n", name);
+        printf("    fields: %zu\n", positions.size());
+        printf("    time: %lld us\n", (long long)time);
+        printf("    mismatches: %lld\n", (long long)mismatch);
+    };
+
+    // Without the precomputed table
+    path::get_table().data.clear();
+    bench("search");
+    bench_frames("frames search");
+
+    // With the precomputed table
+    path::get_table().build();
+    bench("table");
+    bench_frames("frames table");
+};
+
+// Measures the wall-clock time of the searches that split their work on a pool, for every thread count
+// The searches of a thread count share 1 long-lived pool, like in search::Thread
+// The positions are played with a small beam search, so that the attack searches find chains
+void bench_search(const std::vector<i32>& thread_counts)
+{
+    beam::eval::Weight w;
+    load_weight("config.json", w);
+
+    std::vector<std::pair<Field, cell::Queue>> positions;
+
+    for (u32 seed = 0; seed < 4; ++seed) {
+        auto field = Field();
+        auto queue = cell::create_queue(seed);
+
+        auto configs = beam::Configs();
+        configs.width = 60;
+        configs.depth = 10;
+
+        for (i32 i = 0; i < 20; ++i) {
+            auto q = cell::Queue { queue[i], queue[i + 1] };
+            auto qrng = beam::get_queue_random(i % beam::BRANCH, configs.depth - q.size());
+
+            q.insert(q.end(), qrng.begin(), qrng.end());
+
+            auto result = beam::search(field, q, w, configs);
+
+            if (result.candidates.empty()) {
+                break;
+            }
+
+            auto best = *std::max_element(result.candidates.begin(), result.candidates.end());
+
+            field.drop_pair(best.placement.x, best.placement.r, queue[i]);
+            field.pop();
+
+            if (i % 5 == 4) {
+                positions.push_back({ field, { queue[i + 1], queue[i + 2], queue[i + 3] } });
+            }
+        }
+    }
+
+    for (auto thread_count : thread_counts) {
+        Pool pool(thread_count);
+
+        i64 time[3] = { 0 };
+        size_t checksum = 0;
+
+        for (auto& [field, queue] : positions) {
+            auto time_start = std::chrono::high_resolution_clock::now();
+
+            checksum += dfs::build::search(field, queue, dfs::eval::DEFAULT, pool).candidates.size();
+
+            auto time_build = std::chrono::high_resolution_clock::now();
+
+            checksum += dfs::attack::search(field, queue, pool).candidates.size();
+
+            auto time_attack = std::chrono::high_resolution_clock::now();
+
+            checksum += beam::attack::search(field, queue, w, pool).candidates.size();
+
+            auto time_beam = std::chrono::high_resolution_clock::now();
+
+            time[0] += std::chrono::duration_cast<std::chrono::microseconds>(time_build - time_start).count();
+            time[1] += std::chrono::duration_cast<std::chrono::microseconds>(time_attack - time_build).count();
+            time[2] += std::chrono::duration_cast<std::chrono::microseconds>(time_beam - time_attack).count();
+        }
+
+        printf("threads: %d\n", thread_count);
+        printf("    positions: %zu\n", positions.size());
+        printf("    dfs build: %lld us\n", (long long)time[0]);
+        printf("    dfs attack: %lld us\n", (long long)time[1]);
+        printf("    beam attack: %lld us\n", (long long)time[2]);
+        printf("    checksum: %zu\n", checksum);
+    }
+};
+
+// Generates the path finder's table
+void build_path_table(std::string path)
+{
+    auto time_start = std::chrono::high_resolution_clock::now();
+
+    auto table = path::Table();
+    table.build();
+
+    auto time_stop = std::chrono::high_resolution_clock::now();
+    auto time = std::chrono::duration_cast<std::chrono::milliseconds>(time_stop - time_start).count();
+
+    if (!table.save(path)) {
+        printf("failed to save %s\n", path.c_str());
+        return;
+    }
+
+    printf("saved %zu signatures to %s in %lld ms\n", table.data.size(), path.c_str(), (long long)time);
+    printf("path finder stack overflows: %llu\n", (unsigned long long)path::Finder::overflow.load());
+};
+
+int main(int argc, char** argv)
+{
+    if (argc > 1 && std::string(argv[1]) == "path") {
+        bench_path();
+        return 0;
+    }
+
+    // The thread counts to compare, by default 1, 4 and every hardware thread
+    if (argc > 1 && std::string(argv[1]) == "search") {
+        std::vector<i32> thread_counts;
+
+        for (int i = 2; i < argc; ++i) {
+            thread_counts.push_back(std::max(std::stoi(argv[i]), 1));
+        }
+
+        if (thread_counts.empty()) {
+            thread_counts = { 1, 4, std::max(i32(std::thread::hardware_concurrency()), 1) };
+        }
+
+        bench_search(thread_counts);
+        return 0;
+    }
+
+    if (argc > 1 && std::string(argv[1]) == "path_table") {
+        build_path_table(argc > 2 ? argv[2] : path::TABLE_PATH);
+        return 0;
+    }
+
+    save_json();
+
+    if (argc > 1 && std::string(argv[1]) == "bench") {
+        return bench(get_options(argc, argv, 2));
+    }
+
+    if (argc > 1 && std::string(argv[1]) == "ab") {
+        return ab(get_options(argc, argv, 2));
+    }
+
+    return bench(get_options(argc, argv, 1));
 };
\ No newline at end of file
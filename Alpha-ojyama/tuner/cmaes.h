@@ -0,0 +1,295 @@
+#pragma once
+
+#include <random>
+#include <numeric>
+#include "tuner.h"
+
+namespace tuner
+{
+
+namespace cmaes
+{
+
+// The state of the search, saved after every generation so that the tuning can be resumed
+// The values are in steps of the parameters, see get_params()
+struct Checkpoint
+{
+    i32 generation = 0;
+    double sigma = 1.0;
+    std::vector<double> mean;
+    std::vector<double> diag;
+    std::vector<double> path_sigma;
+    std::vector<double> path_c;
+};
+
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(Checkpoint, generation, sigma, mean, diag, path_sigma, path_c)
+
+constexpr const char* CHECKPOINT_PATH = "data/cmaes.json";
+
+inline bool save(const Checkpoint& checkpoint)
+{
+    std::ofstream o(CHECKPOINT_PATH);
+
+    if (!o.good()) {
+        return false;
+    }
+
+    json js;
+    to_json(js, checkpoint);
+
+    o << std::setw(4) << js << std::endl;
+    o.close();
+
+    return true;
+};
+
+inline bool load(Checkpoint& checkpoint)
+{
+    std::ifstream f(CHECKPOINT_PATH);
+
+    if (!f.good()) {
+        return false;
+    }
+
+    json js;
+    f >> js;
+    f.close();
+
+    from_json(js, checkpoint);
+
+    return true;
+};
+
+// Converts a weight to its parameters in steps
+inline std::vector<double> get_vector(beam::eval::Weight w)
+{
+    std::vector<double> result;
+
+    for (auto& [p, step] : tuner::get_params(w)) {
+        result.push_back(double(*p) / double(step));
+    }
+
+    return result;
+};
+
+// Converts parameters in steps to a weight, the other fields are copied from "base"
+inline beam::eval::Weight get_weight(const std::vector<double>& x, beam::eval::Weight base)
+{
+    auto param = tuner::get_params(base);
+
+    for (size_t i = 0; i < param.size(); ++i) {
+        *param[i].first = i32(std::round(x[i] * double(param[i].second)));
+    }
+
+    return tuner::constrain(base);
+};
+
+// Plays every candidate on the same seeds, and counts the candidates each one beats seed by seed with cmp_result()
+// Returns the candidates' wins and their mean scores
+inline std::vector<i32> evaluate(const std::vector<beam::eval::Weight>& candidates, const std::vector<u32>& seeds, Play& play, std::vector<Score>& means)
+{
+    std::vector<Job> jobs;
+
+    for (auto& candidate : candidates) {
+        for (auto seed : seeds) {
+            jobs.push_back(get_job(candidate, seed));
+        }
+    }
+
+    auto results = play(jobs);
+
+    std::vector<std::vector<Score>> scores(candidates.size());
+
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        scores[i].assign(results.begin() + i * seeds.size(), results.begin() + (i + 1) * seeds.size());
+    }
+
+    std::vector<i32> wins(candidates.size(), 0);
+
+    for (size_t k = 0; k < seeds.size(); ++k) {
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            for (size_t j = 0; j < candidates.size(); ++j) {
+                if (cmp_result(scores[j][k], scores[i][k])) {
+                    wins[i] += 1;
+                }
+            }
+        }
+    }
+
+    means.clear();
+
+    for (auto& s : scores) {
+        means.push_back(get_mean(s));
+    }
+
+    return wins;
+};
+
+// Separable CMA-ES (Ros & Hansen, "A Simple Modification in CMA-ES Achieving Linear Time and Space Complexity")
+// Every generation samples a population around the mean, plays it on the same seeds and moves the mean toward the best half
+// The step sizes of the parameters are adapted from the successful steps, so the search can make big moves early and fine-tune later
+// The covariance is kept diagonal, since we only have a few parameters and very noisy evaluations
+// Sampled weights are clamped by constrain(), and the clamped weights are used for the update, so the mean stays in bounds
+inline void run(beam::eval::Weight w, size_t seed_count = SEED_COUNT, Play play = nullptr)
+{
+    system("cls");
+
+    const size_t n = tuner::get_params(w).size();
+
+    // Strategy parameters
+    const size_t lambda = 4 + size_t(3.0 * std::log(double(n)));
+    const size_t mu = lambda / 2;
+
+    std::vector<double> weights(mu);
+    double weights_sum = 0.0;
+
+    for (size_t i = 0; i < mu; ++i) {
+        weights[i] = std::log(double(mu) + 0.5) - std::log(double(i + 1));
+        weights_sum += weights[i];
+    }
+
+    double mu_eff = 0.0;
+
+    for (auto& wi : weights) {
+        wi /= weights_sum;
+        mu_eff += wi * wi;
+    }
+
+    mu_eff = 1.0 / mu_eff;
+
+    const double c_sigma = (mu_eff + 2.0) / (double(n) + mu_eff + 5.0);
+    const double d_sigma = 1.0 + 2.0 * std::max(0.0, std::sqrt((mu_eff - 1.0) / (double(n) + 1.0)) - 1.0) + c_sigma;
+    const double c_c = (4.0 + mu_eff / double(n)) / (double(n) + 4.0 + 2.0 * mu_eff / double(n));
+    const double c_1 = 2.0 / ((double(n) + 1.3) * (double(n) + 1.3) + mu_eff) * (double(n) + 2.0) / 3.0;
+    const double c_mu = std::min(1.0 - c_1, 2.0 * (mu_eff - 2.0 + 1.0 / mu_eff) / ((double(n) + 2.0) * (double(n) + 2.0) + mu_eff) * (double(n) + 2.0) / 3.0);
+    const double chi_n = std::sqrt(double(n)) * (1.0 - 1.0 / (4.0 * double(n)) + 1.0 / (21.0 * double(n) * double(n)));
+
+    // Resumes from the last checkpoint if there is one
+    Checkpoint state;
+
+    if (!cmaes::load(state) || state.mean.size() != n) {
+        state = Checkpoint {
+            .generation = 0,
+            .sigma = 1.0,
+            .mean = cmaes::get_vector(w),
+            .diag = std::vector<double>(n, 1.0),
+            .path_sigma = std::vector<double>(n, 0.0),
+            .path_c = std::vector<double>(n, 0.0)
+        };
+    }
+
+    std::mt19937 rng = std::mt19937(u32(rand()));
+    std::normal_distribution<double> normal(0.0, 1.0);
+
+    // Plays the games on the local pool unless they are played somewhere else
+    Pool pool(play ? 1 : get_game_count());
+
+    if (!play) {
+        play = get_play(pool);
+    }
+
+    while (true)
+    {
+        // Samples the population
+        std::vector<std::vector<double>> ys(lambda, std::vector<double>(n));
+        std::vector<beam::eval::Weight> candidates;
+
+        for (size_t k = 0; k < lambda; ++k) {
+            std::vector<double> x(n);
+
+            for (size_t i = 0; i < n; ++i) {
+                x[i] = state.mean[i] + state.sigma * std::sqrt(state.diag[i]) * normal(rng);
+            }
+
+            candidates.push_back(cmaes::get_weight(x, w));
+
+            // Uses the clamped weight's step
+            auto x_clamped = cmaes::get_vector(candidates.back());
+
+            for (size_t i = 0; i < n; ++i) {
+                ys[k][i] = (x_clamped[i] - state.mean[i]) / state.sigma;
+            }
+        }
+
+        // Ranks the population
+        std::vector<Score> means;
+        auto wins = cmaes::evaluate(candidates, tuner::get_seeds(seed_count), play, means);
+
+        std::vector<size_t> order(lambda);
+        std::iota(order.begin(), order.end(), 0);
+
+        std::stable_sort(
+            order.begin(),
+            order.end(),
+            [&] (size_t a, size_t b) {
+                return wins[a] > wins[b];
+            }
+        );
+
+        // Moves the mean
+        std::vector<double> y_w(n, 0.0);
+
+        for (size_t r = 0; r < mu; ++r) {
+            for (size_t i = 0; i < n; ++i) {
+                y_w[i] += weights[r] * ys[order[r]][i];
+            }
+        }
+
+        for (size_t i = 0; i < n; ++i) {
+            state.mean[i] += state.sigma * y_w[i];
+        }
+
+        // Updates the evolution paths
+        double path_sigma_norm = 0.0;
+
+        for (size_t i = 0; i < n; ++i) {
+            state.path_sigma[i] = (1.0 - c_sigma) * state.path_sigma[i] + std::sqrt(c_sigma * (2.0 - c_sigma) * mu_eff) * y_w[i] / std::sqrt(state.diag[i]);
+            path_sigma_norm += state.path_sigma[i] * state.path_sigma[i];
+        }
+
+        path_sigma_norm = std::sqrt(path_sigma_norm);
+
+        double h_bound = (1.4 + 2.0 / (double(n) + 1.0)) * chi_n;
+        bool h_sigma = path_sigma_norm / std::sqrt(1.0 - std::pow(1.0 - c_sigma, 2.0 * double(state.generation + 1))) < h_bound;
+
+        for (size_t i = 0; i < n; ++i) {
+            state.path_c[i] = (1.0 - c_c) * state.path_c[i] + (h_sigma ? std::sqrt(c_c * (2.0 - c_c) * mu_eff) * y_w[i] : 0.0);
+        }
+
+        // Updates the step sizes
+        for (size_t i = 0; i < n; ++i) {
+            double rank_mu = 0.0;
+
+            for (size_t r = 0; r < mu; ++r) {
+                rank_mu += weights[r] * ys[order[r]][i] * ys[order[r]][i];
+            }
+
+            double rank_1 = state.path_c[i] * state.path_c[i] + (h_sigma ? 0.0 : c_c * (2.0 - c_c) * state.diag[i]);
+
+            state.diag[i] = (1.0 - c_1 - c_mu) * state.diag[i] + c_1 * rank_1 + c_mu * rank_mu;
+        }
+
+        state.sigma *= std::exp((c_sigma / d_sigma) * (path_sigma_norm / chi_n - 1.0));
+
+        state.generation += 1;
+
+        cmaes::save(state);
+
+        // Saves the new mean with the best candidates' scores
+        auto w_mean = cmaes::get_weight(state.mean, w);
+
+        auto save_data = Save {
+            .w = w_mean,
+            .score = { means[order[0]], means[order[1]], means[order[2]] }
+        };
+
+        tuner::save(state.generation - 1, save_data);
+
+        printf("generation: %d | sigma: %.3f | best wins: %d\n", state.generation, state.sigma, wins[order[0]]);
+        printf("best: chain - %d | score - %d | frame - %d\n\n", means[order[0]].chain.count, means[order[0]].chain.score, means[order[0]].frame);
+    }
+};
+
+};
+
+};
\ No newline at end of file
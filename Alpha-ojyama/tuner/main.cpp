@@ -1,4 +1,5 @@
-#include "tuner.h"
+#include "cmaes.h"
+#include "remote.h"
 
 int main()
 {
@@ -7,11 +8,16 @@ int main()
     printf("Choose an action:\n");
     printf("[0] - Train\n");
     printf("[1] - Print\n");
+    printf("[2] - Train with early stopping\n");
+    printf("[3] - Train with successive halving\n");
+    printf("[4] - Train with CMA-ES\n");
+    printf("[5] - Train with remote workers\n");
+    printf("[6] - Work for a remote trainer\n");
 
     i32 user;
     std::cin >> user;
 
-    if (user == 0) {
+    if (user == 0 || user == 2 || user == 3 || user == 4 || user == 5) {
         auto w = beam::eval::Weight();
 
         std::ifstream f("config.json");
@@ -27,7 +33,39 @@ int main()
 
         from_json(js, w);
 
-        tuner::run(w);
+        tuner::Play play = nullptr;
+        tuner::remote::Coordinator coordinator;
+
+        // Plays the games on the workers that connect to us
+        if (user == 5) {
+            printf("Choose a training action [0, 2, 3, 4]:\n");
+            std::cin >> user;
+
+            if (!coordinator.start(tuner::remote::PORT)) {
+                printf("Can't listen on port %d!\n", tuner::remote::PORT);
+                return -1;
+            }
+
+            play = coordinator.get_play();
+        }
+
+        if (user == 3) {
+            tuner::run_halving(w, 0, 8, play);
+        }
+        else if (user == 4) {
+            tuner::cmaes::run(w, tuner::SEED_COUNT, play);
+        }
+        else {
+            tuner::run(w, 0, tuner::SEED_COUNT, user == 2, play);
+        }
+    }
+    else if (user == 6) {
+        printf("Enter the trainer's address:\n");
+
+        std::string host;
+        std::cin >> host;
+
+        tuner::remote::work(host, tuner::remote::PORT);
     }
     else if (user == 1) {
         i32 idx = 0;
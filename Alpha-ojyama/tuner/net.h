@@ -0,0 +1,255 @@
+#pragma once
+
+#include <string>
+#include "../core/def.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <unistd.h>
+#endif
+
+namespace net
+{
+
+#ifdef _WIN32
+typedef SOCKET Handle;
+const Handle HANDLE_INVALID = INVALID_SOCKET;
+#else
+typedef int Handle;
+const Handle HANDLE_INVALID = -1;
+#endif
+
+// A blocking TCP socket that sends and receives lines of text
+class Socket
+{
+public:
+    Handle handle = HANDLE_INVALID;
+    std::string buffer;
+public:
+    bool is_open();
+    bool send_line(const std::string& line);
+    bool receive_line(std::string& line);
+    bool set_timeout(i32 ms);
+    void shutdown();
+    void close();
+public:
+    static bool init();
+    static Socket listen(u16 port);
+    static Socket accept(Socket& server);
+    static Socket connect(const std::string& host, u16 port);
+};
+
+inline bool Socket::is_open()
+{
+    return this->handle != HANDLE_INVALID;
+};
+
+inline bool Socket::send_line(const std::string& line)
+{
+    std::string data = line + "\n";
+    size_t sent = 0;
+
+    while (sent < data.size())
+    {
+#ifdef _WIN32
+        int count = ::send(this->handle, data.data() + sent, int(data.size() - sent), 0);
+#else
+        auto count = ::send(this->handle, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+#endif
+
+        if (count <= 0) {
+            return false;
+        }
+
+        sent += size_t(count);
+    }
+
+    return true;
+};
+
+// Returns false if the connection was closed before a whole line was received
+inline bool Socket::receive_line(std::string& line)
+{
+    while (true)
+    {
+        auto end = this->buffer.find('\n');
+
+        if (end != std::string::npos) {
+            line = this->buffer.substr(0, end);
+            this->buffer.erase(0, end + 1);
+            return true;
+        }
+
+        char data[4096];
+
+        auto count = ::recv(this->handle, data, sizeof(data), 0);
+
+        if (count <= 0) {
+            return false;
+        }
+
+        this->buffer.append(data, size_t(count));
+    }
+};
+
+// Makes sending and receiving fail if they are blocked for more than "ms" milliseconds
+// A timeout of 0 blocks forever
+inline bool Socket::set_timeout(i32 ms)
+{
+#ifdef _WIN32
+    DWORD timeout = DWORD(ms);
+#else
+    timeval timeout = {};
+    timeout.tv_sec = ms / 1000;
+    timeout.tv_usec = (ms % 1000) * 1000;
+#endif
+
+    bool ok = ::setsockopt(this->handle, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout)) == 0;
+    ok = ::setsockopt(this->handle, SOL_SOCKET, SO_SNDTIMEO, (const char*)&timeout, sizeof(timeout)) == 0 && ok;
+
+    return ok;
+};
+
+// Wakes up the threads blocked on the socket
+inline void Socket::shutdown()
+{
+    if (!this->is_open()) {
+        return;
+    }
+
+#ifdef _WIN32
+    ::shutdown(this->handle, SD_BOTH);
+#else
+    ::shutdown(this->handle, SHUT_RDWR);
+#endif
+};
+
+inline void Socket::close()
+{
+    if (!this->is_open()) {
+        return;
+    }
+
+#ifdef _WIN32
+    ::closesocket(this->handle);
+#else
+    ::close(this->handle);
+#endif
+
+    this->handle = HANDLE_INVALID;
+    this->buffer.clear();
+};
+
+// Starts the socket library, only needed on Windows
+inline bool Socket::init()
+{
+#ifdef _WIN32
+    static bool ok = [] () {
+        WSADATA data;
+        return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    }();
+
+    return ok;
+#else
+    return true;
+#endif
+};
+
+inline Socket Socket::listen(u16 port)
+{
+    Socket result = Socket();
+
+    if (!Socket::init()) {
+        return result;
+    }
+
+    result.handle = ::socket(AF_INET, SOCK_STREAM, 0);
+
+    if (!result.is_open()) {
+        return result;
+    }
+
+    int reuse = 1;
+    ::setsockopt(result.handle, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+
+    if (::bind(result.handle, (sockaddr*)&address, sizeof(address)) != 0 || ::listen(result.handle, 64) != 0) {
+        result.close();
+    }
+
+    return result;
+};
+
+inline Socket Socket::accept(Socket& server)
+{
+    Socket result = Socket();
+
+    result.handle = ::accept(server.handle, nullptr, nullptr);
+
+    if (result.is_open()) {
+        int delay = 1;
+        ::setsockopt(result.handle, IPPROTO_TCP, TCP_NODELAY, (const char*)&delay, sizeof(delay));
+    }
+
+    return result;
+};
+
+inline Socket Socket::connect(const std::string& host, u16 port)
+{
+    Socket result = Socket();
+
+    if (!Socket::init()) {
+        return result;
+    }
+
+    addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+
+    addrinfo* info = nullptr;
+
+    if (::getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &info) != 0) {
+        return result;
+    }
+
+    for (auto it = info; it != nullptr; it = it->ai_next) {
+        result.handle = ::socket(it->ai_family, it->ai_socktype, it->ai_protocol);
+
+        if (!result.is_open()) {
+            continue;
+        }
+
+        if (::connect(result.handle, it->ai_addr, int(it->ai_addrlen)) == 0) {
+            break;
+        }
+
+        result.close();
+    }
+
+    ::freeaddrinfo(info);
+
+    if (result.is_open()) {
+        int delay = 1;
+        ::setsockopt(result.handle, IPPROTO_TCP, TCP_NODELAY, (const char*)&delay, sizeof(delay));
+    }
+
+    return result;
+};
+
+};
\ No newline at end of file
@@ -0,0 +1,291 @@
+#pragma once
+
+#include <deque>
+#include "net.h"
+#include "tuner.h"
+
+namespace tuner
+{
+
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(Job, w, seed, width, depth, branch, move)
+
+namespace remote
+{
+
+constexpr u16 PORT = 9137;
+
+// The time a worker has to play 1 game, in milliseconds
+constexpr i32 JOB_TIMEOUT = 10 * 60 * 1000;
+
+// Plays the tuner's games on remote workers
+// The protocol is 1 line of json per message over TCP:
+// - the coordinator sends a job
+// - the worker plays it and sends back its score
+// Every connection plays 1 game at a time, so a worker opens 1 connection per game it can play at once, see work()
+// If a connection is lost, or its worker doesn't answer within "timeout" milliseconds, its job goes back to the queue for another worker
+// The connections' threads are detached, and close() waits for them with the "active" count
+class Coordinator
+{
+public:
+    net::Socket server;
+    std::thread listener;
+    std::vector<net::Socket*> sockets;
+    i32 active = 0;
+    i32 timeout = JOB_TIMEOUT;
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::deque<size_t> queue;
+    std::vector<Job> jobs;
+    std::vector<Score> scores;
+    size_t remain = 0;
+    std::atomic<bool> stop = false;
+public:
+    ~Coordinator();
+public:
+    bool start(u16 port = PORT);
+    void close();
+    std::vector<Score> play(const std::vector<Job>& jobs);
+    Play get_play();
+    i32 get_connection_count();
+public:
+    void serve(net::Socket socket);
+};
+
+inline Coordinator::~Coordinator()
+{
+    this->close();
+};
+
+// Starts accepting workers
+inline bool Coordinator::start(u16 port)
+{
+    this->server = net::Socket::listen(port);
+
+    if (!this->server.is_open()) {
+        return false;
+    }
+
+    this->listener = std::thread([this] () {
+        while (!this->stop)
+        {
+            auto socket = net::Socket::accept(this->server);
+
+            if (!socket.is_open()) {
+                continue;
+            }
+
+            std::lock_guard<std::mutex> lk(this->mtx);
+
+            if (this->stop) {
+                socket.close();
+                break;
+            }
+
+            this->active += 1;
+
+            std::thread([this, socket] () {
+                this->serve(socket);
+            }).detach();
+        }
+    });
+
+    return true;
+};
+
+// Stops accepting workers and disconnects them
+inline void Coordinator::close()
+{
+    if (!this->server.is_open()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lk(this->mtx);
+
+        this->stop = true;
+
+        for (auto socket : this->sockets) {
+            socket->shutdown();
+        }
+    }
+
+    this->cv.notify_all();
+
+    this->server.shutdown();
+    this->server.close();
+
+    if (this->listener.joinable()) {
+        this->listener.join();
+    }
+
+    std::unique_lock<std::mutex> lk(this->mtx);
+
+    this->cv.wait(lk, [&] { return this->active == 0; });
+};
+
+// Plays a batch of games on the workers
+// Blocks until every game is played, waiting for workers to connect if there are none
+inline std::vector<Score> Coordinator::play(const std::vector<Job>& jobs)
+{
+    std::unique_lock<std::mutex> lk(this->mtx);
+
+    this->jobs = jobs;
+    this->scores.assign(jobs.size(), Score());
+    this->remain = jobs.size();
+
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        this->queue.push_back(i);
+    }
+
+    this->cv.notify_all();
+    this->cv.wait(lk, [&] { return this->remain == 0 || this->stop; });
+
+    this->queue.clear();
+
+    return this->scores;
+};
+
+inline Play Coordinator::get_play()
+{
+    return [this] (const std::vector<Job>& jobs) {
+        return this->play(jobs);
+    };
+};
+
+inline i32 Coordinator::get_connection_count()
+{
+    std::lock_guard<std::mutex> lk(this->mtx);
+
+    return i32(this->sockets.size());
+};
+
+// Sends the queued jobs to a worker's connection, one at a time
+// The thread doesn't touch the coordinator after it's removed from the "active" count, since close() may return right away
+inline void Coordinator::serve(net::Socket socket)
+{
+    {
+        std::lock_guard<std::mutex> lk(this->mtx);
+        this->sockets.push_back(&socket);
+    }
+
+    // A hung worker fails its job instead of holding it forever
+    socket.set_timeout(this->timeout);
+
+    while (true)
+    {
+        size_t index = 0;
+        std::string message;
+
+        {
+            std::unique_lock<std::mutex> lk(this->mtx);
+
+            this->cv.wait(lk, [&] { return this->stop || !this->queue.empty(); });
+
+            if (this->stop) {
+                break;
+            }
+
+            index = this->queue.front();
+            this->queue.pop_front();
+
+            json js;
+            to_json(js, this->jobs[index]);
+            message = js.dump();
+        }
+
+        std::string line;
+        auto score = Score();
+        bool ok = socket.send_line(message) && socket.receive_line(line);
+
+        if (ok) {
+            try {
+                from_json(json::parse(line), score);
+            }
+            catch (...) {
+                ok = false;
+            }
+        }
+
+        std::lock_guard<std::mutex> lk(this->mtx);
+
+        // Gives the job to another worker, if the connection was lost or timed out
+        if (!ok) {
+            this->queue.push_front(index);
+            this->cv.notify_all();
+            break;
+        }
+
+        this->scores[index] = score;
+        this->remain -= 1;
+
+        if (this->remain == 0) {
+            this->cv.notify_all();
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lk(this->mtx);
+        this->sockets.erase(std::find(this->sockets.begin(), this->sockets.end(), &socket));
+    }
+
+    socket.close();
+
+    std::lock_guard<std::mutex> lk(this->mtx);
+
+    this->active -= 1;
+    this->cv.notify_all();
+};
+
+// Plays the coordinator's jobs on "slot_count" connections at once, until "stop" is set
+// Lost connections are retried every second, so the workers can be started before the coordinator
+inline void work(const std::string& host, u16 port = PORT, i32 slot_count = get_game_count(), std::atomic<bool>* stop = nullptr)
+{
+    auto is_stopped = [&] () {
+        return stop != nullptr && *stop;
+    };
+
+    Pool pool(slot_count);
+
+    for (i32 i = 0; i < slot_count; ++i) {
+        pool.submit([&] () {
+            while (!is_stopped())
+            {
+                auto socket = net::Socket::connect(host, port);
+
+                if (!socket.is_open()) {
+                    std::this_thread::sleep_for(std::chrono::seconds(1));
+                    continue;
+                }
+
+                std::string line;
+
+                while (!is_stopped() && socket.receive_line(line))
+                {
+                    auto job = Job();
+
+                    try {
+                        from_json(json::parse(line), job);
+                    }
+                    catch (...) {
+                        break;
+                    }
+
+                    json js;
+                    to_json(js, get_score(job));
+
+                    if (!socket.send_line(js.dump())) {
+                        break;
+                    }
+                }
+
+                socket.close();
+            }
+        });
+    }
+
+    pool.wait();
+};
+
+};
+
+};
\ No newline at end of file
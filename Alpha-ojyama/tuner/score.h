@@ -11,20 +11,22 @@ struct Score
     i32 frame = 0;
 };
 
-inline Score get_score(beam::eval::Weight w, u32 seed)
+// Plays a game of at most "move_count" moves
+// Cheaper search configs and shorter games are faster but less accurate
+inline Score get_score(beam::eval::Weight w, u32 seed, beam::Configs configs = beam::Configs(), i32 move_count = 64)
 {
     auto score = Score();
 
     auto field = Field();
     auto queue = cell::create_queue(seed);
 
-    for (i32 i = 0; i < 64; ++i) {
+    for (i32 i = 0; i < move_count; ++i) {
         cell::Queue q = {
             queue[(i + 0) % 128],
             queue[(i + 1) % 128]
         };
 
-        auto ai = beam::search_multi(field, q, w);
+        auto ai = beam::search_multi(field, q, w, configs);
 
         if (ai.candidates.empty()) {
             score = Score {
@@ -64,4 +66,104 @@ inline Score get_score(beam::eval::Weight w, u32 seed)
     return score;
 };
 
+// The number of games played at the same time
+// Each game's searches already run on beam::BRANCH threads
+inline i32 get_game_count()
+{
+    return std::max(i32(std::thread::hardware_concurrency()) / i32(beam::BRANCH), 1);
+};
+
+// A game to play, with the search configs that matter for tuning
+struct Job
+{
+    beam::eval::Weight w = beam::eval::Weight();
+    u32 seed = 0;
+    size_t width = 250;
+    size_t depth = 16;
+    size_t branch = beam::BRANCH;
+    i32 move = 64;
+};
+
+inline Job get_job(beam::eval::Weight w, u32 seed, beam::Configs configs = beam::Configs(), i32 move_count = 64)
+{
+    return Job {
+        .w = w,
+        .seed = seed,
+        .width = configs.width,
+        .depth = configs.depth,
+        .branch = configs.branch,
+        .move = move_count
+    };
+};
+
+inline Score get_score(const Job& job)
+{
+    auto configs = beam::Configs();
+
+    configs.width = job.width;
+    configs.depth = job.depth;
+    configs.branch = job.branch;
+
+    return get_score(job.w, job.seed, configs, job.move);
+};
+
+// Plays a batch of games and returns their scores in the same order
+// The games run on a local pool, see get_play(), or on remote workers, see remote.h
+typedef std::function<std::vector<Score>(const std::vector<Job>&)> Play;
+
+// Plays the games on the local pool
+inline Play get_play(Pool& pool)
+{
+    return [&pool] (const std::vector<Job>& jobs) {
+        std::vector<Score> result(jobs.size());
+
+        for (size_t i = 0; i < jobs.size(); ++i) {
+            pool.submit([&, i] () {
+                result[i] = get_score(jobs[i]);
+            });
+        }
+
+        pool.wait();
+
+        return result;
+    };
+};
+
+// Plays the games of every seed at once
+inline std::vector<Score> get_scores(beam::eval::Weight w, const std::vector<u32>& seeds, Play& play, beam::Configs configs = beam::Configs(), i32 move_count = 64)
+{
+    std::vector<Job> jobs;
+
+    for (auto seed : seeds) {
+        jobs.push_back(get_job(w, seed, configs, move_count));
+    }
+
+    return play(jobs);
+};
+
+// Averages the scores of several games
+inline Score get_mean(const std::vector<Score>& scores)
+{
+    if (scores.empty()) {
+        return Score();
+    }
+
+    i64 count = 0;
+    i64 score = 0;
+    i64 frame = 0;
+
+    for (auto& s : scores) {
+        count += s.chain.count;
+        score += s.chain.score;
+        frame += s.frame;
+    }
+
+    i64 size = i64(scores.size());
+
+    return Score {
+        .chain = { i32(count / size), i32(score / size) },
+        .frame = i32(frame / size)
+    };
+};
+
 };
\ No newline at end of file
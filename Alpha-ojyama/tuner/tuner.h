@@ -6,14 +6,51 @@
 namespace tuner
 {
 
+// The games of each fidelity level, from the cheapest to the full games
+// - width, depth, branch: the search configs, see beam::Configs
+// - move: the maximum moves of a game
+// - seed: the number of seeds played by each candidate
+struct Fidelity
+{
+    size_t width;
+    size_t depth;
+    size_t branch;
+    i32 move;
+    size_t seed;
+};
+
+constexpr Fidelity FIDELITIES[] = {
+    { 50, 8, 2, 32, 8 },
+    { 120, 12, 3, 48, 8 },
+    { 250, 16, 6, 64, 8 }
+};
+
+constexpr i32 FIDELITY_FULL = i32(std::size(FIDELITIES)) - 1;
+
+// "fidelity" is the level of the games that produced the scores
 struct Save
 {
     beam::eval::Weight w;
     std::array<Score, 3> score;
+    i32 fidelity = FIDELITY_FULL;
 };
 
 NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(Score, chain.count, chain.score, frame)
-NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(Save, w, score)
+
+void to_json(json& j, const Save& s)
+{
+    j["w"] = s.w;
+    j["score"] = s.score;
+    j["fidelity"] = s.fidelity;
+};
+
+// The saves from before the fidelity levels only have full games
+void from_json(const json& j, Save& s)
+{
+    j.at("w").get_to(s.w);
+    j.at("score").get_to(s.score);
+    s.fidelity = j.value("fidelity", FIDELITY_FULL);
+};
 
 void save(i32 id, Save s)
 {
@@ -90,13 +127,10 @@ void move_toward(beam::eval::Weight& w, beam::eval::Weight target, i32 id)
     MOVE_TOWARD(waste, 0.1)
 };
 
-std::pair<beam::eval::Weight, beam::eval::Weight> randomize(beam::eval::Weight w, i32 id)
+// The tuned parameters of a weight and their step sizes
+std::vector<std::pair<i32*, i32>> get_params(beam::eval::Weight& w)
 {
-    auto w1 = w;
-    auto w2 = w;
-    auto w_pre = w;
-
-    std::pair<i32*, i32> param[] = {
+    return {
         // { &w.chain, 50 },
         { &w.y, 10 },
         { &w.key, 10 },
@@ -113,10 +147,19 @@ std::pair<beam::eval::Weight, beam::eval::Weight> randomize(beam::eval::Weight w
         { &w.tear, 10 },
         { &w.waste, 10 }
     };
+};
+
+std::pair<beam::eval::Weight, beam::eval::Weight> randomize(beam::eval::Weight w, i32 id)
+{
+    auto w1 = w;
+    auto w2 = w;
+    auto w_pre = w;
+
+    auto param = tuner::get_params(w);
 
-    i32 param_delta[_countof(param)] = { 0 };
+    std::vector<i32> param_delta(param.size(), 0);
 
-    for (size_t i = 0; i < _countof(param); ++i) {
+    for (size_t i = 0; i < param.size(); ++i) {
         i32 delta = param[i].second;
 
         i32 sign = (rand() % 2) * 2 - 1;
@@ -125,7 +168,7 @@ std::pair<beam::eval::Weight, beam::eval::Weight> randomize(beam::eval::Weight w
         param_delta[i] = value * sign;
     }
 
-    for (size_t i = 0; i < _countof(param); ++i) {
+    for (size_t i = 0; i < param.size(); ++i) {
         *param[i].first += param_delta[i];
     }
 
@@ -133,7 +176,7 @@ std::pair<beam::eval::Weight, beam::eval::Weight> randomize(beam::eval::Weight w
 
     w = w_pre;
 
-    for (size_t i = 0; i < _countof(param); ++i) {
+    for (size_t i = 0; i < param.size(); ++i) {
         *param[i].first -= param_delta[i];
     }
 
@@ -142,24 +185,130 @@ std::pair<beam::eval::Weight, beam::eval::Weight> randomize(beam::eval::Weight w
     return { w1, w2 };
 };
 
-i32 match(u32 seed, beam::eval::Weight w1, beam::eval::Weight w2, Score& r1, Score& r2)
+// The number of seeds played by each weight of a match
+constexpr size_t SEED_COUNT = 8;
+
+// The sequential probability ratio test of a match, see match_sprt()
+// - H0: w- wins a decisive seed with chance 0.5 + delta
+// - H1: w+ wins a decisive seed with chance 0.5 + delta
+// "alpha" and "beta" are the chances of accepting the wrong hypothesis
+// "max" is the most seeds played before giving up on a match
+struct Sprt
 {
-    auto cmp_result = [] (Score s1, Score s2) -> bool {
-        bool over_1 = s1.chain.score >= 95000;
-        bool over_2 = s2.chain.score >= 95000;
+    double delta = 0.1;
+    double alpha = 0.05;
+    double beta = 0.05;
+    size_t max = 64;
+};
 
-        if (over_1 != over_2) {
-            return s1.chain.score < s2.chain.score;
-        }
+// Checks if a game is worse than another
+bool cmp_result(Score s1, Score s2)
+{
+    bool over_1 = s1.chain.score >= 95000;
+    bool over_2 = s2.chain.score >= 95000;
+
+    if (over_1 != over_2) {
+        return s1.chain.score < s2.chain.score;
+    }
 
-        double eff_1 = double(s1.chain.score) / double(s1.frame);
-        double eff_2 = double(s2.chain.score) / double(s2.frame);
+    double eff_1 = double(s1.chain.score) / double(s1.frame);
+    double eff_2 = double(s2.chain.score) / double(s2.frame);
 
-        return eff_1 < eff_2;
-    };
+    return eff_1 < eff_2;
+};
+
+// Orders the games like cmp_result(), the chains over 95000 first and then the most efficient
+double get_fitness(Score s)
+{
+    double fitness = double(s.chain.score) / double(std::max(s.frame, 1));
+
+    if (s.chain.score >= 95000) {
+        fitness += 1e9;
+    }
+
+    return fitness;
+};
+
+// The mean fitness of several games
+double get_fitness(const std::vector<Score>& scores)
+{
+    double result = 0.0;
+
+    for (auto& s : scores) {
+        result += tuner::get_fitness(s);
+    }
+
+    return result / double(std::max(scores.size(), size_t(1)));
+};
+
+// Gets the search configs of a fidelity level
+beam::Configs get_configs(i32 fidelity)
+{
+    auto configs = beam::Configs();
+
+    configs.width = FIDELITIES[fidelity].width;
+    configs.depth = FIDELITIES[fidelity].depth;
+    configs.branch = FIDELITIES[fidelity].branch;
+
+    return configs;
+};
+
+// Creates the seeds of a match
+std::vector<u32> get_seeds(size_t count)
+{
+    std::vector<u32> seeds;
+
+    for (size_t i = 0; i < count; ++i) {
+        seeds.push_back(rand() & 0xFFFF);
+    }
+
+    return seeds;
+};
+
+// Plays both weights on every seed in 1 batch
+// Returns the scores of each weight in the seeds' order
+std::pair<std::vector<Score>, std::vector<Score>> get_pairs(const std::vector<u32>& seeds, beam::eval::Weight w1, beam::eval::Weight w2, Play& play)
+{
+    std::vector<Job> jobs;
+
+    for (auto seed : seeds) {
+        jobs.push_back(get_job(w1, seed));
+        jobs.push_back(get_job(w2, seed));
+    }
 
-    r1 = get_score(w1, seed);
-    r2 = get_score(w2, seed);
+    auto scores = play(jobs);
+
+    std::vector<Score> s1;
+    std::vector<Score> s2;
+
+    for (size_t i = 0; i < seeds.size(); ++i) {
+        s1.push_back(scores[i * 2]);
+        s2.push_back(scores[i * 2 + 1]);
+    }
+
+    return { s1, s2 };
+};
+
+// Plays both weights on every seed at once, and compares them seed by seed
+// The weight that wins more seeds wins the match
+// "r1" and "r2" are the mean scores of the weights' games
+i32 match(const std::vector<u32>& seeds, beam::eval::Weight w1, beam::eval::Weight w2, Score& r1, Score& r2, Play& play)
+{
+    auto [s1, s2] = tuner::get_pairs(seeds, w1, w2, play);
+
+    i32 win = 0;
+
+    for (size_t i = 0; i < seeds.size(); ++i) {
+        if (cmp_result(s2[i], s1[i])) {
+            win += 1;
+        }
+        else if (cmp_result(s1[i], s2[i])) {
+            win -= 1;
+        }
+    }
+
+    r1 = get_mean(s1);
+    r2 = get_mean(s2);
 
     printf("\n");
 
@@ -167,33 +316,249 @@ i32 match(u32 seed, beam::eval::Weight w1, beam::eval::Weight w2, Score& r1, Sco
 
     printf("w+: chain - %d | score - %d | frame - %d\n", r1.chain.count, r1.chain.score, r1.frame);
     printf("w-: chain - %d | score - %d | frame - %d\n", r2.chain.count, r2.chain.score, r2.frame);
+    printf("seeds: %zu | w+ wins by %d\n", seeds.size(), win);
 
-    if (cmp_result(r2, r1)) {
+    if (win > 0) {
         return 1;
     }
 
-    if (cmp_result(r1, r2)) {
+    if (win < 0) {
         return -1;
     }
 
     return 0;
 };
 
-inline void run(beam::eval::Weight w, i32 id_init = 0)
+// Plays both weights on paired seeds until the SPRT decides which one is better
+// The seeds are played in batches of get_game_count() pairs, then checked one by one, so the match stops at the first seed that decides it
+// Close weights need many seeds to be told apart, while a clearly better weight wins in a few seeds
+// Returns 0 if nothing was decided after "max" seeds
+// "seeds" is set to the seeds played
+i32 match_sprt(std::vector<u32>& seeds, beam::eval::Weight w1, beam::eval::Weight w2, Score& r1, Score& r2, Play& play, Sprt sprt = Sprt())
+{
+    double p0 = 0.5 - sprt.delta;
+    double p1 = 0.5 + sprt.delta;
+
+    // The log likelihood ratio of a win and a loss of w+
+    double llr_win = std::log(p1 / p0);
+    double llr_loss = std::log((1.0 - p1) / (1.0 - p0));
+
+    double bound_lower = std::log(sprt.beta / (1.0 - sprt.alpha));
+    double bound_upper = std::log((1.0 - sprt.beta) / sprt.alpha);
+
+    double llr = 0.0;
+    i32 result = 0;
+
+    std::vector<Score> s1;
+    std::vector<Score> s2;
+
+    seeds.clear();
+
+    while (result == 0 && seeds.size() < sprt.max)
+    {
+        auto batch = tuner::get_seeds(std::min(size_t(get_game_count()), sprt.max - seeds.size()));
+
+        auto [b1, b2] = tuner::get_pairs(batch, w1, w2, play);
+
+        for (size_t i = 0; i < batch.size(); ++i) {
+            seeds.push_back(batch[i]);
+            s1.push_back(b1[i]);
+            s2.push_back(b2[i]);
+
+            if (cmp_result(b2[i], b1[i])) {
+                llr += llr_win;
+            }
+            else if (cmp_result(b1[i], b2[i])) {
+                llr += llr_loss;
+            }
+
+            if (llr >= bound_upper) {
+                result = 1;
+                break;
+            }
+
+            if (llr <= bound_lower) {
+                result = -1;
+                break;
+            }
+        }
+    }
+
+    r1 = get_mean(s1);
+    r2 = get_mean(s2);
+
+    printf("\n");
+
+    system("cls");
+
+    printf("w+: chain - %d | score - %d | frame - %d\n", r1.chain.count, r1.chain.score, r1.frame);
+    printf("w-: chain - %d | score - %d | frame - %d\n", r2.chain.count, r2.chain.score, r2.frame);
+    printf("seeds: %zu | llr: %.2f [%.2f, %.2f]\n", seeds.size(), llr, bound_lower, bound_upper);
+
+    return result;
+};
+
+// A candidate's result after successive halving
+// "fidelity" is the last level it played, and "score" is its mean score at that level
+struct Rank
+{
+    i32 index = 0;
+    i32 fidelity = 0;
+    double fitness = 0.0;
+    Score score = Score();
+};
+
+// Successive halving
+// Every level plays the remaining candidates on the same seeds, then keeps the best half by get_fitness() for the next level
+// The cheap levels drop the clearly bad candidates, so that only a few candidates play full games
+// Returns every candidate's rank from the best to the worst, the candidates that reached a higher level first
+std::vector<Rank> halve(const std::vector<beam::eval::Weight>& candidates, Play& play)
+{
+    std::vector<Rank> ranks;
+
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        ranks.push_back(Rank { .index = i32(i) });
+    }
+
+    size_t count = ranks.size();
+
+    for (i32 level = 0; level <= FIDELITY_FULL; ++level) {
+        auto seeds = tuner::get_seeds(FIDELITIES[level].seed);
+        auto configs = tuner::get_configs(level);
+
+        std::vector<Job> jobs;
+
+        for (size_t i = 0; i < count; ++i) {
+            for (auto seed : seeds) {
+                jobs.push_back(get_job(candidates[ranks[i].index], seed, configs, FIDELITIES[level].move));
+            }
+        }
+
+        auto results = play(jobs);
+
+        std::vector<std::vector<Score>> scores(count);
+
+        for (size_t i = 0; i < count; ++i) {
+            scores[i].assign(results.begin() + i * seeds.size(), results.begin() + (i + 1) * seeds.size());
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            ranks[i].fidelity = level;
+            ranks[i].fitness = tuner::get_fitness(scores[i]);
+            ranks[i].score = get_mean(scores[i]);
+        }
+
+        std::stable_sort(
+            ranks.begin(),
+            ranks.begin() + count,
+            [] (const Rank& a, const Rank& b) {
+                return a.fitness > b.fitness;
+            }
+        );
+
+        printf("level %d: %zu candidates | best fitness %.2f\n", level, count, ranks.front().fitness);
+
+        count = std::max(count / 2, size_t(1));
+    }
+
+    return ranks;
+};
+
+// Tunes the weight with successive halving
+// Every iteration screens the current weight and "candidate_count" - 1 random perturbations of it, and moves to the best one
+void run_halving(beam::eval::Weight w, i32 id_init = 0, size_t candidate_count = 8, Play play = nullptr)
 {
     system("cls");
 
     i32 id = id_init;
 
+    // Plays the games on the local pool unless they are played somewhere else
+    Pool pool(play ? 1 : get_game_count());
+
+    if (!play) {
+        play = get_play(pool);
+    }
+
+    while (true)
+    {
+        std::vector<beam::eval::Weight> candidates = { w };
+
+        while (candidates.size() < candidate_count)
+        {
+            auto [w1, w2] = tuner::randomize(w, id);
+
+            candidates.push_back(w1);
+
+            if (candidates.size() < candidate_count) {
+                candidates.push_back(w2);
+            }
+        }
+
+        auto ranks = tuner::halve(candidates, play);
+
+        // The current weight is still the best
+        if (ranks.front().index == 0) {
+            continue;
+        }
+
+        w = candidates[ranks.front().index];
+
+        printf("w0: chain - %d | score - %d | frame - %d\n", ranks.front().score.chain.count, ranks.front().score.chain.score, ranks.front().score.frame);
+
+        // Saves the best candidates that played at the same level as the winner
+        auto save_data = Save {
+            .w = w,
+            .score = { Score(), Score(), Score() },
+            .fidelity = ranks.front().fidelity
+        };
+
+        for (size_t i = 0; i < std::min(ranks.size(), save_data.score.size()); ++i) {
+            if (ranks[i].fidelity == save_data.fidelity) {
+                save_data.score[i] = ranks[i].score;
+            }
+        }
+
+        tuner::save(id, save_data);
+
+        printf("id: %d\n\n", id);
+
+        id += 1;
+    }
+};
+
+// Tunes the weight with "seed_count" seeds per match
+// If "sequential" is set, the matches use match_sprt() instead, and play as many seeds as they need
+// The games are shared by a pool of get_game_count() threads, or played by "play" if it's set
+inline void run(beam::eval::Weight w, i32 id_init = 0, size_t seed_count = SEED_COUNT, bool sequential = false, Play play = nullptr)
+{
+    system("cls");
+
+    i32 id = id_init;
+
+    // Plays the games on the local pool unless they are played somewhere else
+    Pool pool(play ? 1 : get_game_count());
+
+    if (!play) {
+        play = get_play(pool);
+    }
+
     while (true)
     {
         auto [w1, w2] = tuner::randomize(w, id);
 
         Score s0, s1, s2;
 
-        u32 seed = rand() & 0xFFFF;
+        std::vector<u32> seeds;
 
-        i32 m = tuner::match(seed, w1, w2, s1, s2);
+        i32 m = 0;
+
+        if (sequential) {
+            m = tuner::match_sprt(seeds, w1, w2, s1, s2, play);
+        }
+        else {
+            seeds = tuner::get_seeds(seed_count);
+            m = tuner::match(seeds, w1, w2, s1, s2, play);
+        }
 
         if (m == 1) {
             tuner::move_toward(w, w1, id);
@@ -205,7 +570,7 @@ inline void run(beam::eval::Weight w, i32 id_init = 0)
             continue;
         }
 
-        s0 = get_score(w, seed);
+        s0 = get_mean(get_scores(w, seeds, play));
 
         printf("w0: chain - %d | score - %d | frame - %d\n", s0.chain.count, s0.chain.score, s0.frame);
 